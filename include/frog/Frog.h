@@ -33,6 +33,11 @@
 #define FROG_H
 
 #include <set>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <atomic>
+#include <ostream>
 #include "ticcutils/LogStream.h"
 #include "ticcutils/Configuration.h"
 #include "ticcutils/Timer.h"
@@ -46,22 +51,115 @@ std::string prefix( const std::string&, const std::string& );
 std::string getTime();
 void getFileNames( const std::string&, const std::string&, std::set<std::string>& );
 
+class AnnotationBuffer {
+  // collects the FoLiA updates a module wants to make for one sentence.
+  // Modules only read the FoLiA tree while classifying, and the collected
+  // updates are applied in one go by commit(), by the thread that owns the
+  // sentence.
+ public:
+  void add( const std::function<void()>& f ){ updates.push_back( f ); };
+  bool empty() const { return updates.empty(); };
+  void commit();
+  void clear(){ updates.clear(); };
+  void append( const AnnotationBuffer& b ){
+    updates.insert( updates.end(), b.updates.begin(), b.updates.end() );
+  };
+ private:
+  std::vector<std::function<void()>> updates;
+};
+
+class SentenceRecord {
+  // a structure-of-arrays view of one sentence, passed between the modules.
+  // The text and the token classes are taken from FoLiA once, the modules
+  // add their results for the modules that come after them, and for the
+  // columned output (see SentenceRecords).
+ public:
+  SentenceRecord(){};
+  SentenceRecord( const std::vector<folia::Word*>& ws,
+		  const std::string& textclass ){ fill( ws, textclass ); };
+  void fill( const std::vector<folia::Word*>&, const std::string& );
+  size_t size() const { return words.size(); };
+  bool empty() const { return words.empty(); };
+  std::vector<folia::Word*> words;
+  std::vector<UnicodeString> text;
+  std::vector<std::string> token_class;
+  // added by the PoS tagger
+  std::vector<std::string> tags;
+  std::vector<std::string> heads;
+  std::vector<std::vector<std::string>> features;
+  std::vector<double> confidences;
+  // added by the lemmatizer: the first lemma of every word
+  std::vector<std::string> lemmas;
+  // added by the morphological analyzer: the analyses of every word, as
+  // bracketed strings, and with deep morphology their compound types
+  std::vector<std::vector<std::string>> morphs;
+  std::vector<std::vector<std::string>> compounds;
+  // added by the chunker and the NER tagger: the B- and I- tag of every
+  // word, empty outside a chunk or entity
+  std::vector<std::string> chunks;
+  std::vector<std::string> entities;
+  // added by the MWU chunker: start and length of every multi word unit
+  std::vector<std::pair<size_t,size_t>> mwus;
+  // added by the parser, for every unit (a multi word unit or a single
+  // word): the number of the unit it depends on (0 for none) and the
+  // relation. Empty when the sentence isn't parsed
+  std::vector<int> dep_heads;
+  std::vector<std::string> dep_rels;
+};
+
+class SentenceRecords {
+  // the records of frogged sentences, kept for the columned output, so
+  // that doesn't need the FoLiA tree. Owned by whoever owns the sentences.
+  // Records may be added by several threads at once.
+ public:
+  void add( folia::Sentence *, SentenceRecord&& );
+  const SentenceRecord *find( folia::Sentence * ) const;
+ private:
+  std::unordered_map<folia::Sentence*,SentenceRecord> records;
+};
+
+class ModuleTimer {
+  // the time a module took, both on the wall clock and in CPU time, the
+  // number of calls and the number of tokens handled.
+  // The start of a measurement is kept per thread, and the totals are
+  // atomic, so any number of threads may time the same module at once.
+ public:
+  ModuleTimer(){ reset(); };
+  void start();
+  void stop( size_t=0 );
+  void reset();
+  void add( const ModuleTimer& );
+  double secs() const { return wall_ns.load() / 1e9; };
+  double cpuSecs() const { return cpu_ns.load() / 1e9; };
+  unsigned long long calls() const { return num_calls.load(); };
+  unsigned long long tokens() const { return num_tokens.load(); };
+ private:
+  std::atomic<long long> wall_ns;
+  std::atomic<long long> cpu_ns;
+  std::atomic<unsigned long long> num_calls;
+  std::atomic<unsigned long long> num_tokens;
+  ModuleTimer( const ModuleTimer& ); // inhibit copies
+  ModuleTimer& operator=( const ModuleTimer& ); // inhibit copies
+};
+
+std::ostream& operator<<( std::ostream&, const ModuleTimer& );
+
 class TimerBlock{
 public:
-  TiCC::Timer parseTimer;
-  TiCC::Timer tokTimer;
-  TiCC::Timer mblemTimer;
-  TiCC::Timer mbmaTimer;
-  TiCC::Timer mwuTimer;
-  TiCC::Timer tagTimer;
-  TiCC::Timer iobTimer;
-  TiCC::Timer nerTimer;
-  TiCC::Timer prepareTimer;
-  TiCC::Timer pairsTimer;
-  TiCC::Timer relsTimer;
-  TiCC::Timer dirTimer;
-  TiCC::Timer csiTimer;
-  TiCC::Timer frogTimer;
+  ModuleTimer parseTimer;
+  ModuleTimer tokTimer;
+  ModuleTimer mblemTimer;
+  ModuleTimer mbmaTimer;
+  ModuleTimer mwuTimer;
+  ModuleTimer tagTimer;
+  ModuleTimer iobTimer;
+  ModuleTimer nerTimer;
+  ModuleTimer prepareTimer;
+  ModuleTimer pairsTimer;
+  ModuleTimer relsTimer;
+  ModuleTimer dirTimer;
+  ModuleTimer csiTimer;
+  ModuleTimer frogTimer;
   void reset(){
     parseTimer.reset();
     tokTimer.reset();
@@ -78,6 +176,23 @@ public:
     csiTimer.reset();
     frogTimer.reset();
   }
+  void add( const TimerBlock& tb ){
+    // merge the totals of tb, e.g. of another worker, into ours
+    parseTimer.add( tb.parseTimer );
+    tokTimer.add( tb.tokTimer );
+    mblemTimer.add( tb.mblemTimer );
+    mbmaTimer.add( tb.mbmaTimer );
+    mwuTimer.add( tb.mwuTimer );
+    tagTimer.add( tb.tagTimer );
+    iobTimer.add( tb.iobTimer );
+    nerTimer.add( tb.nerTimer );
+    prepareTimer.add( tb.prepareTimer );
+    pairsTimer.add( tb.pairsTimer );
+    relsTimer.add( tb.relsTimer );
+    dirTimer.add( tb.dirTimer );
+    csiTimer.add( tb.csiTimer );
+    frogTimer.add( tb.frogTimer );
+  }
 };
 
 
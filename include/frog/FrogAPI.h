@@ -40,15 +40,23 @@
 #include <vector>
 #include <string>
 #include <iostream>
+#include <functional>
+#include <memory>
+#include <chrono>
+#include <csignal>
 
 class UctoTokenizer;
 class Mbma;
+class MbmaContext;
 class Mblem;
+class MblemContext;
 class Mwu;
 class Parser;
 class POSTagger;
 class IOBTagger;
 class NERTagger;
+struct PipeItem;
+class ColumnFormatter;
 
 class FrogOptions {
  public:
@@ -64,6 +72,12 @@ class FrogOptions {
   bool doQuoteDetection;
   bool doDirTest;
   bool doServer;
+  bool doFramed;
+  bool doStreaming;
+  unsigned int batchWindow; // in ms, 0 means no batching
+  unsigned int requestDeadline; // in ms, 0 means no deadline
+  unsigned int maxQueue; // 0 means no limit
+  std::string metricsFile; // where a server writes its metrics, if anywhere
 
   bool doXMLin;
   bool doXMLout;
@@ -72,6 +86,7 @@ class FrogOptions {
   int debugFlag;
   bool interactive;
   int numThreads;
+  int numWorkers;
 
   std::string encoding;
   std::string uttmark;
@@ -89,6 +104,58 @@ class FrogOptions {
 };
 
 
+class FrogWorker {
+  // the set of modules needed to frog a sentence.
+  // every worker thread gets its own set, so they can run side by side.
+  // Mbma, Mblem and Mwu are reentrant, so the workers share those, and
+  // only need contexts of their own for Mbma and Mblem: one for every
+  // thread a sentence is split over (see --threads).
+  // The Parsers of the workers share their Timbl trees, only the taggers
+  // are really loaded per worker.
+ public:
+ FrogWorker():
+  myTokenizer(0),
+    myParser(0),
+    myPoSTagger(0),
+    myIOBTagger(0),
+    myNERTagger(0),
+    hasDeadline(false)
+    {};
+  ~FrogWorker();
+  UctoTokenizer *myTokenizer; // only needed when frogging whole files
+  std::vector<MbmaContext*> mbmaContexts;
+  std::vector<MblemContext*> mblemContexts;
+  Parser *myParser;
+  POSTagger *myPoSTagger;
+  IOBTagger *myIOBTagger;
+  NERTagger *myNERTagger;
+  TimerBlock timers;
+  // the deadline of the server request at hand (see --deadline), and the
+  // sentences for which we skipped work because it passed
+  void setDeadline( const std::chrono::steady_clock::time_point& );
+  void clearDeadline();
+  bool pastDeadline() const {
+    return hasDeadline && std::chrono::steady_clock::now() > deadline;
+  };
+  std::vector<folia::Sentence*> skippedParses;
+  std::vector<folia::Sentence*> skippedMorphs;
+ private:
+  std::chrono::steady_clock::time_point deadline;
+  bool hasDeadline;
+  FrogWorker( const FrogWorker& ); // inhibit copies
+};
+
+struct ServerPool;
+struct ServerRequest;
+class ServerMetrics;
+
+struct FrogJob {
+  // a file to frog, and where to store the results
+  std::string inName;
+  std::string outName;  // when empty, results go to a shared stream
+  std::string xmlName;
+};
+
 class FrogAPI {
  public:
   FrogAPI( FrogOptions&,
@@ -98,26 +165,72 @@ class FrogAPI {
   static std::string defaultConfigDir( const std::string& ="" );
   static std::string defaultConfigFile( const std::string& ="" );
   void FrogFile( const std::string&, std::ostream&, const std::string& );
-  void FrogDoc( folia::Document&, bool=false );
+  void FrogFiles( const std::vector<FrogJob>&, std::ostream& );
+  void FrogDoc( folia::Document&, bool=false, SentenceRecords * = 0 );
   void FrogServer( Sockets::ServerSocket &conn );
+  void startServer();
+  void serveConnection( Sockets::ServerSocket * );
+  void stopServer();
+  void runServer( Sockets::ServerSocket&,
+		  volatile sig_atomic_t&, volatile sig_atomic_t& );
+  void reloadModels();
   void FrogInteractive();
   std::string Frogtostring( const std::string& );
   std::string Frogtostringfromfile( const std::string& );
 
  private:
   // functions
-  bool TestSentence( folia::Sentence*, TimerBlock&);
+  bool TestSentence( folia::Sentence*, FrogWorker&, SentenceRecords * = 0 );
+  bool initWorker( FrogWorker& );
+  void initContexts( FrogWorker& );
+  bool initPipeline();
+  UctoTokenizer *initTokenizer() const;
+  void TestDocument( folia::Document&, FrogWorker *,
+		     const std::function<void(folia::Sentence*)>& = nullptr,
+		     SentenceRecords * = 0 );
+  void TestSentences( const std::vector<folia::Sentence*>&, FrogWorker *,
+		      const std::function<void(folia::Sentence*)>& = nullptr,
+		      SentenceRecords * = 0 );
+  void FrogFile( const std::string&, std::ostream&, const std::string&,
+		 FrogWorker& );
   void FrogStdin( bool prompt );
-  std::vector<folia::Word*> lookup( folia::Word *,
-				    const std::vector<folia::Entity*>& ) const;
-  folia::Dependency *lookupDep( const folia::Word *,
-				const std::vector<folia::Dependency*>& ) const;
-  std::string lookupNEREntity( const std::vector<folia::Word *>&,
-			       const std::vector<folia::Entity*>& ) const;
-  std::string lookupIOBChunk( const std::vector<folia::Word *>&,
-			      const std::vector<folia::Chunk*>& ) const;
-  void displayMWU( std::ostream&, size_t, const std::vector<folia::Word*>& ) const;
-  std::ostream& showResults( std::ostream&, folia::Document& ) const;
+  void FrogStream( std::istream&, std::ostream&, FrogWorker * );
+  void FrogPipeline( std::istream&, std::ostream& );
+  void runStage( int, FrogWorker&, PipeItem& );
+  void serverThread( size_t );
+  void reloadThread();
+  void reportThread();
+  void prepareServing();
+  std::shared_ptr<FrogAPI> currentEngine() const;
+  void FrogServer( Sockets::ServerSocket &, FrogWorker& );
+  void FrogRequest( const std::string&, std::ostream&, FrogWorker&,
+		    const std::function<void(const std::string&)>&,
+		    const std::chrono::steady_clock::time_point& );
+  std::string deadlineNotice( size_t, size_t ) const;
+  std::string rejectNotice() const;
+  folia::Document *requestDocument( const std::string&, UctoTokenizer *,
+				    TimerBlock& );
+  std::string sentenceResults( folia::Sentence *,
+			       const SentenceRecords * = 0 ) const;
+  void requestResults( folia::Document&, std::ostream&,
+		       const std::function<void(const std::string&)>&,
+		       const SentenceRecords * = 0 );
+  void batchThread();
+  void frogBatch( const std::vector<ServerRequest*>&,
+		  const std::function<void(const ServerRequest&,
+					   const std::string&)>& );
+  void returnPart( const ServerRequest&, const std::string& );
+  void releaseModels();
+  void FrogDoc( folia::Document&, FrogWorker&,
+		const std::function<void(folia::Sentence*)>&,
+		SentenceRecords * = 0 );
+  void returnRequest( ServerRequest * );
+  void addDeclarations( folia::Document& ) const;
+  void resetTimers();
+  void showTimers() const;
+  void showTimers( const TimerBlock&, const TimerBlock& ) const;
+  std::ostream& showResults( std::ostream&, folia::Document&,
+			     const SentenceRecords * = 0 ) const;
 
   // data
   const TiCC::Configuration& configuration;
@@ -133,6 +246,18 @@ class FrogAPI {
   IOBTagger *myIOBTagger;
   NERTagger *myNERTagger;
   UctoTokenizer *tokenizer;
+  ColumnFormatter *formatter;
+  // workers[0] holds the tagger and parser modules above, the others
+  // have private copies
+  std::vector<FrogWorker*> workers;
+  // settings from the [[pipeline]] section of the configuration
+  bool doPipeline;
+  size_t pipeQueueSize;
+  std::vector<int> stageThreads;
+  // the server threads and the connections waiting for them
+  ServerPool *serverPool;
+  // the metrics of the server we work for, if any
+  ServerMetrics *metrics;
 };
 
 std::vector<std::string> get_full_morph_analysis( folia::Word *, bool = false );
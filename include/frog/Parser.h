@@ -33,6 +33,7 @@
 #define PARSER_H
 
 struct parseData;
+class timbl_result;
 
 class Parser {
  public:
@@ -48,16 +49,17 @@ class Parser {
       };
   ~Parser();
   bool init( const TiCC::Configuration& );
+  bool init( const Parser& );
   void addDeclaration( folia::Document& doc ) const;
-  void Parse( const std::vector<folia::Word *>&, TimerBlock& );
-  parseData prepareParse( const std::vector<folia::Word *>& );
+  void Parse( SentenceRecord&, TimerBlock&, AnnotationBuffer& );
+  parseData prepareParse( const SentenceRecord& );
 
   std::vector<std::string> createParserInstances( const parseData& );
   std::string getTagset() const { return dep_tagset; };
  private:
-  std::vector<std::string> createPairInstances( const parseData& );
-  std::vector<std::string> createDirInstances( const parseData& );
-  std::vector<std::string> createRelInstances( const parseData& );
+  void classifyPairs( const parseData&, std::vector<timbl_result>& );
+  void classifyDirs( const parseData&, std::vector<timbl_result>& );
+  void classifyRels( const parseData&, std::vector<timbl_result>& );
 
   Timbl::TimblAPI *pairs;
   Timbl::TimblAPI *dir;
@@ -72,6 +74,15 @@ class Parser {
   std::string MWU_tagset;
   std::string textclass;
   Tokenizer::UnicodeFilter *filter;
+  // the instances are built in these, which keep their room from
+  // sentence to sentence
+  std::string pairInst;
+  std::string dirInst;
+  std::string relInst;
+  std::vector<std::string> wordWindows;
+  std::vector<std::string> tagWindows;
+  std::vector<std::string> leftDistances;
+  std::vector<std::string> rightDistances;
   Parser( const Parser& ){}; // inhibit copies
 };
 
@@ -38,9 +38,13 @@ class CGNTagger: public POSTagger {
  public:
   explicit CGNTagger( TiCC::LogStream *l ): POSTagger( l ){};
   bool init( const TiCC::Configuration& );
-  void Classify( const std::vector<folia::Word *>& );
-  void post_process( const std::vector<folia::Word *>& words );
+  void Classify( SentenceRecord&, AnnotationBuffer& );
+  void post_process( SentenceRecord&, AnnotationBuffer& );
  private:
+  void add_features( const std::vector<folia::Word *>&,
+		     const std::vector<std::string>&,
+		     const std::vector<std::vector<std::string>>&,
+		     const std::vector<std::vector<std::string>>& ) const;
   void fillSubSetTable();
   std::string getSubSet( const std::string& , const std::string& );
   std::multimap<std::string,std::string> cgnSubSets;
@@ -1,98 +1,113 @@
 #ifndef CKYPARSER_H
 #define CKYPARSER_H
 
-#include <set>
+#include <map>
+#include <vector>
+#include <string>
+#include <cstdint>
 
 enum dirType { ROOT, LEFT, RIGHT, ERROR };
 
-class Constraint {
+class RelationTable {
+  // the relation labels of a sentence, as small numbers
  public:
-  enum ConstraintType { Incoming, Dependency, Direction };
- Constraint( double w, int i ): weight(w),tokenIndex(i){
-  };
-  virtual ~Constraint(){};
-  virtual void put( std::ostream& os ) const {
-    os << tokenIndex << " " << weight;
-  };
-  virtual ConstraintType type() const = 0;
-  virtual dirType direct() const { return ERROR; };
-  virtual std::string rel() const { return "NOREL"; };
-  virtual int hIndex() const { abort(); };
-  int tIndex() const { return tokenIndex; };
-  double wght() const { return weight; };
- protected:
+  enum { NO_REL = 0, ROOT_REL = 1 };
+  RelationTable();
+  int intern( const std::string& );
+  const std::string& name( int id ) const { return names[id]; };
+ private:
+  std::map<std::string,int> ids;
+  std::vector<std::string> names;
+};
+
+// the constraints the parser gets from the classifiers. head 0 is the root
+struct DependencyConstraint {
+  int dep;
+  int head;
+  int rel;
   double weight;
-  int    tokenIndex;
 };
 
-std::ostream& operator<<( std::ostream& os, const Constraint& c );
-std::ostream& operator<<( std::ostream& os, const Constraint* c );
+struct DirectionConstraint {
+  int token;
+  dirType dir;
+  double weight;
+};
 
-class HasIncomingRel: public Constraint {
- public:
- HasIncomingRel( int i, const std::string& r, double w ):
-  Constraint( w, i ), relType(r){
-  };
-  void put( std::ostream& ) const;
-  ConstraintType type() const { return Incoming; }
-  std::string rel() const { return relType; };
- private:
-  std::string relType;
+struct IncomingConstraint {
+  int token;
+  int rel;
+  double weight;
 };
 
-class HasDependency: public Constraint {
+class ConstraintSet {
  public:
- HasDependency( int i, int h, const std::string& r, double w ):
-  Constraint( w, i ), relType(r), headType(h) {
-    };
-  void put( std::ostream& ) const;
-  ConstraintType type() const { return Dependency; };
-  int hIndex() const { return headType; };
-  std::string rel() const { return relType; };
- private:
-  std::string relType;
-  int headType;
+  explicit ConstraintSet( size_t num ): numTokens( num ){};
+  void addDependency( int, int, const std::string&, double );
+  void addDirection( int, const std::string&, double );
+  void addIncoming( int, const std::string&, double );
+  size_t numTokens;
+  RelationTable relations;
+  std::vector<DependencyConstraint> dependencies;
+  std::vector<DirectionConstraint> directions;
+  std::vector<IncomingConstraint> incoming;
 };
 
-class DependencyDirection: public Constraint {
+template <typename T>
+class SlotArray {
+  // a list of items for every slot, all in one contiguous array.
+  // Fill it in two passes: count() every item, then place() them
+  // in the same order
  public:
- DependencyDirection( int i, const std::string& d, double w ):
-  Constraint( w, i ), direction(toEnum(d)){
-  }
-  void put( std::ostream& ) const;
-  ConstraintType type() const { return Direction; };
-  dirType direct() const { return direction; };
- private:
-  dirType toEnum( const std::string& s ){
-    if ( s == "ROOT" )
-      return ROOT;
-    else if ( s == "LEFT" )
-      return LEFT;
-    else if ( s == "RIGHT" )
-      return RIGHT;
-    else {
-      abort();
+  struct Range {
+    const T *first;
+    const T *last;
+    const T *begin() const { return first; };
+    const T *end() const { return last; };
+    bool empty() const { return first == last; };
+    size_t size() const { return last - first; };
+  };
+  void init( size_t slots ){ start.assign( slots + 2, 0 ); };
+  void count( size_t slot ){ ++start[slot+2]; };
+  void allocate(){
+    for ( size_t i=1; i < start.size(); ++i ){
+      start[i] += start[i-1];
     }
-  }
-  dirType direction;
+    items.resize( start.back() );
+  };
+  T& place( size_t slot ){ return items[start[slot+1]++]; };
+  Range operator[]( size_t slot ) const {
+    const T *base = items.data();
+    return Range{ base + start[slot], base + start[slot+1] };
+  };
+ private:
+  std::vector<T> items;
+  std::vector<size_t> start;
 };
 
+// a set of the constraints of one token, one bit per constraint
+typedef uint64_t ConstraintBits;
+
 class SubTree {
  public:
- SubTree( double score, int r, const std::string& label ):
-  _score( score ), _r( r ), _edgeLabel( label ){
+ SubTree( double score, int r, int label ):
+  _score( score ), _r( r ), _edgeLabel( label ), leftSat( 0 ), rightSat( 0 ){
   }
  SubTree( ):
-  _score( 0.0 ), _r( -1 ), _edgeLabel( "" ){
+  _score( 0.0 ), _r( -1 ), _edgeLabel( -1 ), leftSat( 0 ), rightSat( 0 ){
   }
-  std::set<const Constraint*>  satisfiedConstraints;
   double score() const { return _score; };
   int r() const { return _r; };
-  std::string edgeLabel() const { return _edgeLabel; };
+  int edgeLabel() const { return _edgeLabel; };
  private:
   double _score;
   int _r;
-  std::string _edgeLabel;
+  int _edgeLabel;
+ public:
+  // the constraints satisfied in this subtree, of the first and of the
+  // last token of its span. (the parser never asks for the others)
+  ConstraintBits leftSat;
+  ConstraintBits rightSat;
 };
 
 struct parsrel {
@@ -110,7 +125,7 @@ class chart_rec {
 
 class CKYParser {
 public:
-  CKYParser( size_t, const std::vector<const Constraint*>& );
+  explicit CKYParser( const ConstraintSet& );
   void parse();
   void leftIncomplete( int , int , std::vector<parsrel>& );
   void rightIncomplete( int , int , std::vector<parsrel>& );
@@ -118,13 +133,35 @@ public:
   void rightComplete( int , int , std::vector<parsrel>& );
 
 private:
-  void addConstraint( const Constraint * );
-  std::string bestEdge( const SubTree& , const SubTree& , size_t , size_t,
-			std::set<const Constraint*>&, double& );
+  struct Edge {
+    int rel;
+    double weight;
+  };
+  struct Incoming {
+    // an incoming relation, and its bit in the ConstraintBits of its token
+    int rel;
+    double weight;
+    ConstraintBits bit;
+  };
+  struct Direction {
+    dirType dir;
+    double weight;
+    ConstraintBits bit;
+  };
+  void fillCell( size_t, size_t );
+  size_t edgeSlot( size_t, size_t ) const;
+  SlotArray<Edge>::Range edges( size_t, size_t ) const;
+  bool fixedEdge( size_t, size_t ) const;
+  int bestEdge( const SubTree& , const SubTree& , size_t , size_t,
+		ConstraintBits&, ConstraintBits&, double& ) const;
   size_t numTokens;
-  std::vector< std::vector<const Constraint*>> inDepConstraints;
-  std::vector< std::vector<const Constraint*>> outDepConstraints;
-  std::vector< std::vector< std::vector<const Constraint*>>> edgeConstraints;
+  const RelationTable& relations;
+  SlotArray<Incoming> inDepConstraints;
+  SlotArray<Direction> outDepConstraints;
+  // the edge constraints of every dependent: to the root, and to the heads
+  // at most band tokens away. See edgeSlot()
+  size_t band;
+  SlotArray<Edge> edgeConstraints;
   std::vector< std::vector<chart_rec>> chart;
 
 };
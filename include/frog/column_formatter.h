@@ -0,0 +1,96 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2017
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+
+#ifndef COLUMN_FORMATTER_H
+#define COLUMN_FORMATTER_H
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include "ticcutils/Configuration.h"
+#include "ticcutils/LogStream.h"
+#include "libfolia/folia.h"
+
+class FrogOptions;
+class SentenceRecord;
+class SentenceRecords;
+struct ColumnIndex;
+struct ColumnWord;
+struct ColumnUnit;
+
+class ColumnFormatter {
+  // writes a FoLiA document in Frog's tab separated column format.
+  // All settings are resolved once, at construction, so writing never has
+  // to consult the configuration.
+  // A sentence is written from its SentenceRecord when there is one, so
+  // the FoLiA tree is only read for sentences that have none, like the
+  // sentence parts of quote detection.
+ public:
+  ColumnFormatter( const FrogOptions&,
+		   const TiCC::Configuration&,
+		   TiCC::LogStream * );
+  std::ostream& show( std::ostream&, folia::Document&,
+		      const SentenceRecords * = 0 ) const;
+  std::ostream& showSentence( std::ostream&, folia::Sentence * ) const;
+  std::ostream& showSentence( std::ostream&, const SentenceRecord& ) const;
+  // the tagsets of the active modules. Empty when a module isn't used
+  std::string pos_tagset;
+  std::string lemma_tagset;
+  std::string mwu_tagset;
+  std::string iob_tagset;
+  std::string ner_tagset;
+  std::string dep_tagset;
+ private:
+  void indexSentence( folia::Sentence *, ColumnIndex& ) const;
+  std::vector<folia::Word*> lookup( folia::Word *,
+				    const ColumnIndex& ) const;
+  folia::Dependency *lookupDep( folia::Word *,
+				const ColumnIndex& ) const;
+  ColumnWord foliaWord( folia::Word *, const ColumnIndex& ) const;
+  void foliaUnits( folia::Sentence *, std::vector<ColumnUnit>& ) const;
+  ColumnWord recordWord( const SentenceRecord&, size_t ) const;
+  void recordUnits( const SentenceRecord&, std::vector<ColumnUnit>& ) const;
+  void displayMWU( std::ostream&, size_t, const ColumnUnit& ) const;
+  void showUnits( std::ostream&, const std::vector<ColumnUnit>& ) const;
+  bool doLemma;
+  bool doMorph;
+  bool doDeepMorph;
+  bool doIOB;
+  bool doNER;
+  bool doParse;
+  bool doQuoteDetection;
+  int debugFlag;
+  int parserDebug;
+  std::string outputclass;
+  TiCC::LogStream *theErrLog;
+};
+
+#endif // COLUMN_FORMATTER_H
@@ -38,7 +38,7 @@ class IOBTagger {
   ~IOBTagger();
   bool init( const TiCC::Configuration& );
   void addDeclaration( folia::Document& ) const;
-  void Classify( const std::vector<folia::Word *>& );
+  void Classify( SentenceRecord&, AnnotationBuffer& );
   std::string getTagset() const { return tagset; };
   std::string set_eos_mark( const std::string& );
  private:
@@ -46,9 +46,14 @@ class IOBTagger {
 		 const std::vector<folia::Word*>&,
 		 const std::vector<double>&,
 		 const std::string& );
-  void addIOBTags( const std::vector<folia::Word*>&,
+  void addChunks( const std::vector<folia::Word*>&,
+		  const std::vector<std::vector<folia::Word*>>&,
+		  const std::vector<std::vector<double>>&,
+		  const std::vector<std::string>& );
+  void addIOBTags( SentenceRecord&,
 		   const std::vector<std::string>&,
-		   const std::vector<double>& );
+		   const std::vector<double>&,
+		   AnnotationBuffer& );
   MbtAPI *tagger;
   TiCC::LogStream *iobLog;
   int debug;
@@ -44,17 +44,43 @@ class mblemData {
   std::string tag;
 };
 
+class Mblem;
+class AnnotationBuffer;
+class SentenceRecord;
+
+class MblemContext {
+  // the per-call state of the lemmatizer. Every thread using a Mblem brings
+  // its own context, so one Mblem (and its IGTree) can serve many threads.
+ public:
+  explicit MblemContext( const Mblem& );
+  ~MblemContext();
+  std::vector<mblemData> mblemResult;
+ private:
+  friend class Mblem;
+  Timbl::TimblAPI *myLex; // shares the instance base with the Mblem
+  MblemContext( const MblemContext& ); // inhibit copies
+};
+
 class Mblem {
+  friend class MblemContext;
  public:
   explicit Mblem( TiCC::LogStream * );
   ~Mblem();
   bool init( const TiCC::Configuration& );
   void addDeclaration( folia::Document& doc ) const;
-  void Classify( folia::Word * );
-  void Classify( const UnicodeString& );
-  std::vector<std::pair<std::string,std::string> > getResult() const;
-  void filterTag( const std::string&  );
-  void makeUnique();
+  void Classify( SentenceRecord&, size_t,
+		 MblemContext&,
+		 AnnotationBuffer& ) const;
+  void Classify( SentenceRecord&,
+		 MblemContext&,
+		 AnnotationBuffer& ) const;
+  void Classify( SentenceRecord&,
+		 const std::vector<MblemContext*>&,
+		 AnnotationBuffer& ) const;
+  void Classify( const UnicodeString&, MblemContext& ) const;
+  std::vector<std::pair<std::string,std::string> > getResult( const MblemContext& ) const;
+  void filterTag( const std::string&, MblemContext& ) const;
+  void makeUnique( MblemContext& ) const;
   std::string getTagset() const { return tagset; };
   bool fill_ts_map( const std::string& );
   bool fill_eq_set( const std::string& );
@@ -62,9 +88,13 @@ class Mblem {
   void read_transtable( const std::string& );
   void create_MBlem_defaults();
   bool readsettings( const std::string& dir, const std::string& fname );
-  void addLemma( folia::Word *, const std::string&) ;
-  std::string make_instance( const UnicodeString& in );
-  void getFoLiAResult( folia::Word *, const UnicodeString& );
+  void addLemma( SentenceRecord&, size_t, const std::string&,
+		 AnnotationBuffer& ) const;
+  std::string make_instance( const UnicodeString& in ) const;
+  void getFoLiAResult( SentenceRecord&, size_t,
+		       const UnicodeString&,
+		       const MblemContext&,
+		       AnnotationBuffer& ) const;
   Timbl::TimblAPI *myLex;
   std::string punctuation;
   size_t history;
@@ -73,7 +103,6 @@ class Mblem {
   std::map<std::string,std::string> classMap;
   std::map<std::string, std::map<std::string, int>> token_strip_map;
   std::set<std::string> one_one_tags;
-  std::vector<mblemData> mblemResult;
   std::string version;
   std::string tagset;
   std::string POS_tagset;
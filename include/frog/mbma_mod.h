@@ -39,6 +39,8 @@
 #include "frog/mbma_brackets.h"
 
 class MBMAana;
+class AnnotationBuffer;
+class SentenceRecord;
 namespace Timbl{
   class TimblAPI;
 }
@@ -58,24 +60,59 @@ namespace folia {
   class Morpheme;
 }
 
+class Mbma;
+
+class MbmaContext {
+  // the per-call state of the morphological analyzer. Every thread using a
+  // Mbma brings its own context, so one Mbma (and its IGTree) can serve
+  // many threads.
+ public:
+  explicit MbmaContext( const Mbma& );
+  ~MbmaContext();
+  void clearAnalysis();
+  std::vector<Rule*> analysis;
+  bool deep; // give deep morphology. Starts as the setting of the Mbma
+ private:
+  friend class Mbma;
+  Timbl::TimblAPI *MTree; // shares the instance base with the Mbma
+  Transliterator *transliterator;
+  MbmaContext( const MbmaContext& ); // inhibit copies
+};
+
 class Mbma {
+  friend class MbmaContext;
  public:
  explicit Mbma( TiCC::LogStream * );
   ~Mbma();
   bool init( const TiCC::Configuration& );
   void addDeclaration( folia::Document& doc ) const;
-  void Classify( folia::Word * );
-  void Classify( const UnicodeString& );
-  void filterHeadTag( const std::string& );
-  void filterSubTags( const std::vector<std::string>& );
-  void assign_compounds();
-  std::vector<std::string> getResult() const;
-  std::vector<std::pair<std::string,std::string>> getResults( ) const;
+  void Classify( SentenceRecord&, size_t,
+		 MbmaContext&,
+		 AnnotationBuffer& ) const;
+  void Classify( SentenceRecord&,
+		 MbmaContext&,
+		 AnnotationBuffer& ) const;
+  void Classify( SentenceRecord&,
+		 MbmaContext&,
+		 AnnotationBuffer&,
+		 bool ) const;
+  void Classify( SentenceRecord&,
+		 const std::vector<MbmaContext*>&,
+		 AnnotationBuffer&,
+		 bool ) const;
+  void Classify( const UnicodeString&, MbmaContext& ) const;
+  void filterHeadTag( const std::string&, MbmaContext& ) const;
+  void filterSubTags( const std::vector<std::string>&, MbmaContext& ) const;
+  void assign_compounds( MbmaContext& ) const;
+  std::vector<std::string> getResult( const MbmaContext& ) const;
+  std::vector<std::pair<std::string,std::string>> getResults( const MbmaContext& ) const;
   void setDeepMorph( bool b ){ doDeepMorph = b; };
-  void clearAnalysis();
-  Rule* matchRule( const std::vector<std::string>&, const UnicodeString& );
+  Rule* matchRule( const std::vector<std::string>&,
+		   const UnicodeString&,
+		   bool ) const;
   std::vector<Rule*> execute( const UnicodeString& ,
-			      const std::vector<std::string>& );
+			      const std::vector<std::string>&,
+			      bool ) const;
   static std::map<std::string,std::string> TAGconv;
   static std::string mbma_tagset;
   static std::string cgn_tagset;
@@ -86,23 +123,35 @@ class Mbma {
   void fillMaps();
   void init_cgn( const std::string&, const std::string& );
   Transliterator * init_trans();
-  UnicodeString filterDiacritics( const UnicodeString& ) const;
-  void getFoLiAResult( folia::Word *, const UnicodeString& ) const;
-  std::vector<std::string> make_instances( const UnicodeString& word );
+  UnicodeString filterDiacritics( const UnicodeString&,
+				  const MbmaContext& ) const;
+  void getFoLiAResult( SentenceRecord&, size_t,
+		       const std::string&,
+		       const UnicodeString&,
+		       const MbmaContext&,
+		       AnnotationBuffer& ) const;
+  std::vector<std::string> make_instances( const UnicodeString& word ) const;
   CLEX::Type getFinalTag( const std::list<BaseBracket*>& );
   int debugFlag;
   void addMorph( folia::MorphologyLayer *,
 		 const std::vector<std::string>& ) const;
-  void addMorph( folia::Word *, const std::vector<std::string>& ) const;
-  void addBracketMorph( folia::Word *,
+  void addMorph( SentenceRecord&, size_t,
+		 const std::vector<std::string>&,
+		 AnnotationBuffer& ) const;
+  void addBracketMorph( SentenceRecord&, size_t,
 			const std::string&,
-			const std::string& ) const;
-  void addBracketMorph( folia::Word *,
 			const std::string&,
-			const BracketNest * ) const;
+			const std::string&,
+			AnnotationBuffer& ) const;
+  void addBracketMorph( SentenceRecord&, size_t,
+			const std::string&,
+			const BracketNest *,
+			AnnotationBuffer& ) const;
+  void addMorpheme( SentenceRecord&, size_t,
+		    folia::Morpheme *,
+		    AnnotationBuffer& ) const;
   std::string MTreeFilename;
   Timbl::TimblAPI *MTree;
-  std::vector<Rule*> analysis;
   std::string version;
   std::string textclass;
   TiCC::LogStream *mbmaLog;
@@ -0,0 +1,80 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2017
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include "frog/Frog.h"
+
+class LatencyHistogram {
+  // counts how many observations fall in each of a fixed set of buckets
+  // (in seconds), the way Prometheus expects them
+ public:
+  LatencyHistogram();
+  void observe( double );
+  void write( std::ostream&, const std::string&, const std::string& ) const;
+ private:
+  std::vector<unsigned long long> counts; // one extra for +Inf
+  unsigned long long total;
+  double sum;
+};
+
+class ServerMetrics {
+  // the numbers a Frog server keeps about itself. The server threads add
+  // to them, a reporter thread writes them out every second in the
+  // Prometheus text format
+ public:
+  ServerMetrics();
+  void addRequests( size_t, size_t, size_t );
+  void addTimes( const TimerBlock& );
+  void addRejected();
+  void connectionOpened(){ ++connections; };
+  void connectionClosed(){ --connections; };
+  void write( std::ostream&, size_t );
+ private:
+  std::mutex lock;
+  std::chrono::steady_clock::time_point last_write;
+  unsigned long long requests;
+  unsigned long long sentences;
+  unsigned long long tokens;
+  unsigned long long rejected;
+  // the totals at the previous write, to compute the rates
+  unsigned long long last_requests;
+  unsigned long long last_sentences;
+  unsigned long long last_tokens;
+  std::vector<LatencyHistogram> modules;
+  std::atomic<long> connections;
+};
+
+#endif // METRICS_H
@@ -35,7 +35,7 @@
 class mwuAna {
   friend std::ostream& operator<< (std::ostream&, const mwuAna& );
  public:
-  mwuAna( folia::Word *, const std::string&, const std::string& );
+  mwuAna( folia::Word *, const std::string&, bool );
   virtual ~mwuAna() {};
 
   void merge( const mwuAna * );
@@ -45,9 +45,7 @@ class mwuAna {
   }
 
   bool isSpec(){ return spec; };
-  folia::EntitiesLayer *addEntity( const std::string&,
-				   folia::Sentence *,
-				   folia::EntitiesLayer * );
+  const std::vector<folia::Word *>& getFWords() const { return fwords; };
 
  protected:
     mwuAna(){};
@@ -59,24 +57,20 @@ class mwuAna {
 #define mymap2 std::multimap<std::string, std::vector<std::string> >
 
 class Mwu {
-  friend std::ostream& operator<< (std::ostream&, const Mwu& );
  public:
   explicit Mwu(TiCC::LogStream*);
   ~Mwu();
-  void reset();
   bool init( const TiCC::Configuration& );
   void addDeclaration( folia::Document& ) const;
-  void Classify( const std::vector<folia::Word *>& );
-  void add( folia::Word * );
+  void Classify( SentenceRecord&, AnnotationBuffer& ) const;
   std::string getTagset() const { return mwu_tagset; };
-  std::vector<mwuAna*>& getAna(){ return mWords; };
  private:
   bool readsettings( const std::string&, const std::string&);
   bool read_mwus( const std::string& );
-  void Classify();
+  mwuAna *make_ana( const SentenceRecord&, size_t ) const;
+  void Classify( std::vector<mwuAna*>&, const mymap2& ) const;
   int debug;
   std::string mwuFileName;
-  std::vector<mwuAna*> mWords;
   mymap2 MWUs;
   TiCC::LogStream *mwuLog;
   std::string version;
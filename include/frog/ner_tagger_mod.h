@@ -32,16 +32,20 @@
 #ifndef NER_TAGGER_MOD_H
 #define NER_TAGGER_MOD_H
 
+class AnnotationBuffer;
+class SentenceRecord;
+
 class NERTagger {
  public:
   explicit NERTagger( TiCC::LogStream * );
   ~NERTagger();
   bool init( const TiCC::Configuration& );
-  void Classify( const std::vector<folia::Word *>& );
+  void Classify( SentenceRecord&, AnnotationBuffer& );
   void addDeclaration( folia::Document& ) const;
-  void addNERTags( const std::vector<folia::Word*>&,
+  void addNERTags( SentenceRecord&,
 		   const std::vector<std::string>&,
-		   const std::vector<double>& );
+		   const std::vector<double>&,
+		   AnnotationBuffer& );
   std::string getTagset() const { return tagset; };
   std::vector<Tagger::TagResult> tagLine( const std::string& );
   bool fill_known_ners( const std::string& );
@@ -0,0 +1,152 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2017
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+// the stages of the Frog pipeline, in processing order
+enum PipeStage { TAG_STAGE, IOB_STAGE, NER_STAGE, LEMMA_STAGE, MORPH_STAGE,
+		 MWU_STAGE, PARSE_STAGE, NUM_STAGES };
+
+template <typename T>
+class BoundedQueue {
+  // a fixed size multi-producer/multi-consumer queue without locks.
+  // (after Dmitry Vyukov's bounded MPMC queue)
+  // Every cell holds a sequence number that tells a producer when the cell
+  // is free, and a consumer when it is filled.
+ public:
+  explicit BoundedQueue( size_t );
+  ~BoundedQueue(){ delete [] cells; };
+  bool try_push( const T& );
+  bool try_pop( T& );
+  void push( const T& );
+ private:
+  struct Cell {
+    std::atomic<size_t> seq;
+    T data;
+  };
+  Cell *cells;
+  size_t mask;
+  // keep the positions on their own cache lines
+  char pad0[64];
+  std::atomic<size_t> enqueue_pos;
+  char pad1[64];
+  std::atomic<size_t> dequeue_pos;
+  char pad2[64];
+  BoundedQueue( const BoundedQueue& ); // inhibit copies
+  BoundedQueue& operator=( const BoundedQueue& ); // inhibit copies
+};
+
+inline void pipe_backoff( unsigned int& spins ){
+  // wait for a queue to become usable. Yield a few times, then sleep
+  if ( ++spins < 64 ){
+    std::this_thread::yield();
+  }
+  else {
+    std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+  }
+}
+
+template <typename T>
+BoundedQueue<T>::BoundedQueue( size_t size ){
+  size_t cap = 2;
+  while ( cap < size ){
+    cap *= 2;
+  }
+  cells = new Cell[cap];
+  mask = cap - 1;
+  for ( size_t i=0; i < cap; ++i ){
+    cells[i].seq.store( i, std::memory_order_relaxed );
+  }
+  enqueue_pos.store( 0, std::memory_order_relaxed );
+  dequeue_pos.store( 0, std::memory_order_relaxed );
+}
+
+template <typename T>
+bool BoundedQueue<T>::try_push( const T& val ){
+  size_t pos = enqueue_pos.load( std::memory_order_relaxed );
+  while ( true ){
+    Cell *cell = &cells[pos & mask];
+    size_t seq = cell->seq.load( std::memory_order_acquire );
+    intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+    if ( dif == 0 ){
+      if ( enqueue_pos.compare_exchange_weak( pos, pos + 1,
+					      std::memory_order_relaxed ) ){
+	cell->data = val;
+	cell->seq.store( pos + 1, std::memory_order_release );
+	return true;
+      }
+    }
+    else if ( dif < 0 ){
+      // full
+      return false;
+    }
+    else {
+      pos = enqueue_pos.load( std::memory_order_relaxed );
+    }
+  }
+}
+
+template <typename T>
+bool BoundedQueue<T>::try_pop( T& val ){
+  size_t pos = dequeue_pos.load( std::memory_order_relaxed );
+  while ( true ){
+    Cell *cell = &cells[pos & mask];
+    size_t seq = cell->seq.load( std::memory_order_acquire );
+    intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+    if ( dif == 0 ){
+      if ( dequeue_pos.compare_exchange_weak( pos, pos + 1,
+					      std::memory_order_relaxed ) ){
+	val = cell->data;
+	cell->seq.store( pos + mask + 1, std::memory_order_release );
+	return true;
+      }
+    }
+    else if ( dif < 0 ){
+      // empty
+      return false;
+    }
+    else {
+      pos = dequeue_pos.load( std::memory_order_relaxed );
+    }
+  }
+}
+
+template <typename T>
+void BoundedQueue<T>::push( const T& val ){
+  unsigned int spins = 0;
+  while ( !try_push( val ) ){
+    pipe_backoff( spins );
+  }
+}
+
+#endif // PIPELINE_H
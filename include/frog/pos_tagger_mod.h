@@ -34,14 +34,18 @@
 
 #include "mbt/MbtAPI.h"
 
+class AnnotationBuffer;
+class SentenceRecord;
+
 class POSTagger {
  public:
   explicit POSTagger( TiCC::LogStream * );
   virtual ~POSTagger();
   virtual bool init( const TiCC::Configuration& );
-  virtual void Classify( const std::vector<folia::Word *>& );
+  virtual void Classify( SentenceRecord&, AnnotationBuffer& );
   void addDeclaration( folia::Document& ) const;
-  void addTag( folia::Word *, const std::string&, double, bool );
+  void addTag( SentenceRecord&, size_t, const std::string&, double, bool,
+	       AnnotationBuffer& );
   std::vector<Tagger::TagResult> tagLine( const std::string& );
   std::string getTagset() const { return tagset; };
   bool fill_map( const std::string&, std::map<std::string,std::string>& );
@@ -0,0 +1,1607 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2017
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+#include <cstdlib>
+#include <string>
+#include <cstdlib>
+#include <cerrno>
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <functional>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include "config.h"
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
+#ifdef HAVE_SYS_EPOLL_H
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+#include "ticcutils/StringOps.h"
+#include "frog/FrogAPI.h"
+#include "frog/ucto_tokenizer_mod.h"
+#include "frog/pos_tagger_mod.h"
+#include "frog/iob_tagger_mod.h"
+#include "frog/ner_tagger_mod.h"
+#include "frog/column_formatter.h"
+#include "frog/metrics.h"
+
+using namespace std;
+using namespace folia;
+
+#define LOG *TiCC::Log(theErrLog)
+
+// In the framed protocol (--framed) every request and every reply is a
+// 4 byte length, in network byte order, followed by that many bytes of
+// UTF-8 text. There are no end markers.
+const size_t FRAME_HEADER = 4;
+const size_t MAX_FRAME = 1 << 28; // refuse absurd lengths
+
+static void set_frame_length( char *header, size_t len ){
+  uint32_t net = htonl( static_cast<uint32_t>( len ) );
+  memcpy( header, &net, FRAME_HEADER );
+}
+
+static size_t get_frame_length( const char *header ){
+  uint32_t net;
+  memcpy( &net, header, FRAME_HEADER );
+  return ntohl( net );
+}
+
+static bool recv_all( int fd, char *buf, size_t len ){
+  // blocking read of exactly len bytes
+  while ( len > 0 ){
+    ssize_t got = ::recv( fd, buf, len, MSG_WAITALL );
+    if ( got < 0 && errno == EINTR ){
+      continue;
+    }
+    if ( got <= 0 ){
+      return false;
+    }
+    buf += got;
+    len -= got;
+  }
+  return true;
+}
+
+static bool send_all( int fd, iovec *iov, int cnt ){
+  // blocking gather write of all of iov. We use sendmsg() as a writev()
+  // that doesn't raise SIGPIPE on a closed connection
+  while ( cnt > 0 ){
+    msghdr msg;
+    memset( &msg, 0, sizeof(msg) );
+    msg.msg_iov = iov;
+    msg.msg_iovlen = cnt;
+    ssize_t sent = ::sendmsg( fd, &msg, MSG_NOSIGNAL );
+    if ( sent < 0 ){
+      if ( errno == EINTR ){
+	continue;
+      }
+      return false;
+    }
+    size_t done = sent;
+    while ( cnt > 0 && done >= iov->iov_len ){
+      done -= iov->iov_len;
+      ++iov;
+      --cnt;
+    }
+    if ( cnt > 0 ){
+      iov->iov_base = static_cast<char*>(iov->iov_base) + done;
+      iov->iov_len -= done;
+    }
+  }
+  return true;
+}
+
+static bool read_frame( int fd, string& data ){
+  // read one framed request. The payload comes in with one recv straight
+  // into data, which callers may reuse between requests
+  char header[FRAME_HEADER];
+  if ( !recv_all( fd, header, FRAME_HEADER ) ){
+    return false;
+  }
+  size_t len = get_frame_length( header );
+  if ( len > MAX_FRAME ){
+    throw runtime_error( "frame too large: " + TiCC::toString(len) );
+  }
+  data.resize( len );
+  return len == 0 || recv_all( fd, &data[0], len );
+}
+
+static bool write_frame( int fd, const string& data ){
+  char header[FRAME_HEADER];
+  set_frame_length( header, data.size() );
+  iovec iov[2];
+  iov[0].iov_base = header;
+  iov[0].iov_len = FRAME_HEADER;
+  iov[1].iov_base = const_cast<char*>( data.data() );
+  iov[1].iov_len = data.size();
+  return send_all( fd, iov, 2 );
+}
+
+struct ServerRequest {
+  // one request from the event loop, to be frogged by a server thread
+  size_t conn_id;
+  string input;
+  string output;
+  vector<string> parts; // a streamed reply, made by a batch
+  chrono::steady_clock::time_point arrived;
+  bool failed;
+  bool last; // false for the parts of a streamed reply
+};
+
+struct ServerPool {
+  // the work waiting for a free server thread: whole connections in
+  // blocking mode, or single requests from the event loop
+  mutex lock;
+  condition_variable ready;
+  deque<Sockets::ServerSocket*> pending;
+  deque<ServerRequest*> requests;
+  deque<ServerRequest*> done;
+  int wakeup_fd; // signals the event loop that requests are done
+  vector<thread> threads;
+  bool stopping;
+  // what we tell about ourselves (see --metrics). Declared before the
+  // engine, as that may point to it until it is gone
+  ServerMetrics metrics;
+  condition_variable tick; // wakes the reporter, to stop
+  thread reporter;
+  // the FrogAPI whose models serve new requests. Requests in progress keep
+  // the one they started with alive
+  shared_ptr<FrogAPI> engine;
+  thread reloader;
+  bool reloading;
+};
+
+
+void FrogAPI::prepareServing(){
+  // make every worker ready to handle server requests on its own
+  for ( const auto& w : workers ){
+    if ( !w->myTokenizer ){
+      // only the first worker got a tokenizer at startup
+      w->myTokenizer = initTokenizer();
+      if ( !w->myTokenizer ){
+	throw runtime_error( "Frog init failed" );
+      }
+    }
+    // the taggers must know the utterance marker of the tokenizer
+    w->myPoSTagger->set_eos_mark( options.uttmark );
+    if ( w->myIOBTagger ){
+      w->myIOBTagger->set_eos_mark( options.uttmark );
+    }
+    if ( w->myNERTagger ){
+      w->myNERTagger->set_eos_mark( options.uttmark );
+    }
+  }
+}
+
+shared_ptr<FrogAPI> FrogAPI::currentEngine() const {
+  // only the FrogAPI that runs the server has a pool. A reloaded engine
+  // just frogs
+  assert( serverPool );
+  lock_guard<mutex> guard( serverPool->lock );
+  return serverPool->engine;
+}
+
+static bool expired( const ServerRequest& req, unsigned int budget ){
+  // did req run out of time? budget is in ms, 0 means no limit
+  return budget > 0
+    && chrono::steady_clock::now()
+    > req.arrived + chrono::milliseconds( budget );
+}
+
+static string notice_line( const string& message, bool xml ){
+  // a remark for the client, after the results. A comment, so it doesn't
+  // break the XML or the columns
+  if ( xml ){
+    return "<!-- frog: " + message + " -->\n";
+  }
+  return "# frog: " + message + "\n";
+}
+
+string FrogAPI::deadlineNotice( size_t parses, size_t morphs ) const {
+  // tell the client what we skipped because its deadline passed. Empty
+  // when nothing was skipped
+  if ( parses == 0 && morphs == 0 ){
+    return "";
+  }
+  string what;
+  if ( parses > 0 ){
+    what = "parsing of " + TiCC::toString( parses ) + " sentence(s)";
+  }
+  if ( morphs > 0 ){
+    if ( !what.empty() ){
+      what += " and ";
+    }
+    what += "deep morphology of " + TiCC::toString( morphs )
+      + " sentence(s), which got shallow morphology instead";
+  }
+  return notice_line( "deadline exceeded, skipped " + what,
+		      options.doXMLout );
+}
+
+string FrogAPI::rejectNotice() const {
+  return notice_line( "deadline exceeded while waiting, request not frogged",
+		      options.doXMLout );
+}
+
+void FrogAPI::startServer(){
+  // start one server thread per worker. Each thread handles one connection
+  // or request at a time, using the modules of its own worker. Mbma, Mblem
+  // and Mwu are shared by all of them.
+  serverPool = new ServerPool();
+  serverPool->stopping = false;
+  serverPool->reloading = false;
+  serverPool->wakeup_fd = -1;
+  prepareServing();
+  // we serve with our own models, until a reload replaces them. Then only
+  // those models are freed, not the rest of us
+  serverPool->engine = shared_ptr<FrogAPI>( this, []( FrogAPI *frog ){
+      frog->releaseModels();
+    } );
+  metrics = &serverPool->metrics;
+  if ( !options.metricsFile.empty() ){
+    serverPool->reporter = thread( &FrogAPI::reportThread, this );
+    LOG << "writing metrics to " << options.metricsFile << endl;
+  }
+#ifdef HAVE_SYS_EPOLL_H
+  if ( options.batchWindow > 0 ){
+    serverPool->threads.push_back( thread( &FrogAPI::batchThread, this ) );
+    LOG << "started a batching server thread, with a window of "
+	<< options.batchWindow << " ms" << endl;
+    return;
+  }
+#else
+  if ( options.batchWindow > 0 ){
+    LOG << "--batch-window is not supported on this system. Ignored" << endl;
+  }
+#endif
+  for ( size_t i=0; i < workers.size(); ++i ){
+    serverPool->threads.push_back( thread( &FrogAPI::serverThread, this, i ) );
+  }
+  LOG << "started " << workers.size() << " server threads" << endl;
+}
+
+void FrogAPI::reloadModels(){
+  // load a fresh set of models in the background. New requests use it as
+  // soon as it is ready, the old set is freed when the last request that
+  // uses it is done.
+  {
+    lock_guard<mutex> guard( serverPool->lock );
+    if ( serverPool->reloading ){
+      LOG << "a reload is already running" << endl;
+      return;
+    }
+    serverPool->reloading = true;
+  }
+  if ( serverPool->reloader.joinable() ){
+    serverPool->reloader.join();
+  }
+  serverPool->reloader = thread( &FrogAPI::reloadThread, this );
+}
+
+void FrogAPI::reloadThread(){
+  LOG << "reloading the models..." << endl;
+  TiCC::Timer reloadTimer;
+  reloadTimer.start();
+  FrogAPI *fresh = 0;
+  try {
+    // the configuration (and so the options) is the same, only the model
+    // files may have changed. fresh only frogs: it gets our metrics, but no
+    // pool. The pool threads stay ours, and they hand every reply (and
+    // streamed part) back themselves
+    fresh = new FrogAPI( options, configuration, theErrLog );
+    fresh->prepareServing();
+    fresh->metrics = metrics;
+  }
+  catch ( std::exception& e ){
+    LOG << "reloading failed: " << e.what()
+	<< ". Continuing with the current models." << endl;
+    delete fresh;
+    fresh = 0;
+  }
+  reloadTimer.stop();
+  shared_ptr<FrogAPI> old;
+  {
+    lock_guard<mutex> guard( serverPool->lock );
+    if ( fresh ){
+      old = serverPool->engine;
+      serverPool->engine = shared_ptr<FrogAPI>( fresh );
+    }
+    serverPool->reloading = false;
+  }
+  if ( fresh ){
+    LOG << "new models in use, reloading took: " << reloadTimer << endl;
+  }
+  // when old goes out of scope here, no request uses it anymore, and the
+  // old models are freed
+}
+
+void FrogAPI::serveConnection( Sockets::ServerSocket *conn ){
+  // hand an accepted connection to the server threads, who take ownership
+  metrics->connectionOpened();
+  {
+    lock_guard<mutex> guard( serverPool->lock );
+    serverPool->pending.push_back( conn );
+  }
+  serverPool->ready.notify_one();
+}
+
+void FrogAPI::stopServer(){
+  if ( !serverPool ){
+    return;
+  }
+  {
+    lock_guard<mutex> guard( serverPool->lock );
+    serverPool->stopping = true;
+  }
+  serverPool->ready.notify_all();
+  serverPool->tick.notify_all();
+  for ( auto& t : serverPool->threads ){
+    t.join();
+  }
+  if ( serverPool->reporter.joinable() ){
+    serverPool->reporter.join();
+  }
+  if ( serverPool->reloader.joinable() ){
+    serverPool->reloader.join();
+  }
+  for ( const auto& conn : serverPool->pending ){
+    delete conn;
+  }
+  for ( const auto& req : serverPool->requests ){
+    delete req;
+  }
+  for ( const auto& req : serverPool->done ){
+    delete req;
+  }
+#ifdef HAVE_SYS_EPOLL_H
+  if ( serverPool->wakeup_fd >= 0 ){
+    ::close( serverPool->wakeup_fd );
+  }
+#endif
+  ServerPool *pool = serverPool;
+  serverPool = 0;
+  // releases our own models, unless a reload replaced them already
+  delete pool;
+  metrics = 0;
+}
+
+void FrogAPI::reportThread(){
+  // write the metrics to the --metrics file, every second. We write a new
+  // file and rename it, so readers never see half a report
+  const string tmp = options.metricsFile + ".tmp";
+  bool complained = false;
+  unique_lock<mutex> guard( serverPool->lock );
+  while ( !serverPool->stopping ){
+    serverPool->tick.wait_for( guard, chrono::seconds( 1 ) );
+    size_t queued = serverPool->requests.size()
+      + serverPool->pending.size();
+    guard.unlock();
+    bool ok;
+    {
+      ofstream os( tmp );
+      serverPool->metrics.write( os, queued );
+      ok = os.good();
+    }
+    if ( !ok || rename( tmp.c_str(), options.metricsFile.c_str() ) != 0 ){
+      if ( !complained ){
+	LOG << "unable to write metrics to " << options.metricsFile << endl;
+	complained = true;
+      }
+    }
+    else {
+      complained = false;
+    }
+    guard.lock();
+  }
+}
+
+void FrogAPI::serverThread( size_t index ){
+  // handle connections or requests, with worker index of the current models
+#ifdef HAVE_OPENMP
+  // a new thread doesn't inherit the setting of the main thread
+  omp_set_num_threads( options.numThreads );
+#endif
+  while ( true ){
+    Sockets::ServerSocket *conn = 0;
+    ServerRequest *req = 0;
+    {
+      unique_lock<mutex> guard( serverPool->lock );
+      while ( !serverPool->stopping
+	      && serverPool->pending.empty()
+	      && serverPool->requests.empty() ){
+	serverPool->ready.wait( guard );
+      }
+      if ( serverPool->stopping ){
+	break;
+      }
+      if ( !serverPool->requests.empty() ){
+	req = serverPool->requests.front();
+	serverPool->requests.pop_front();
+      }
+      else {
+	conn = serverPool->pending.front();
+	serverPool->pending.pop_front();
+      }
+    }
+    if ( req && expired( *req, options.requestDeadline ) ){
+      // it waited too long already, don't start on it
+      metrics->addRejected();
+      req->output = rejectNotice();
+      returnRequest( req );
+      continue;
+    }
+    shared_ptr<FrogAPI> engine = currentEngine();
+    FrogWorker *w = engine->workers[index];
+    if ( req ){
+      ostringstream outputstream;
+      auto emit = [&]( const string& part ){
+	returnPart( *req, part );
+      };
+      try {
+	engine->FrogRequest( req->input, outputstream, *w, emit,
+			     req->arrived );
+	req->output = outputstream.str();
+      }
+      catch ( std::exception& e ){
+	if ( options.debugFlag ){
+	  LOG << "request failed: " << e.what() << endl;
+	}
+	req->failed = true;
+      }
+      returnRequest( req );
+    }
+    else {
+      engine->FrogServer( *conn, *w );
+      delete conn;
+      metrics->connectionClosed();
+    }
+  }
+}
+
+void FrogAPI::returnRequest( ServerRequest *req ){
+  // give a (part of a) reply back to the event loop, and wake it up
+  assert( serverPool );
+  {
+    lock_guard<mutex> guard( serverPool->lock );
+    serverPool->done.push_back( req );
+  }
+#ifdef HAVE_SYS_EPOLL_H
+  uint64_t one = 1;
+  if ( ::write( serverPool->wakeup_fd, &one, sizeof(one) ) < 0 ){
+    LOG << "unable to wake up the event loop: " << strerror(errno) << endl;
+  }
+#endif
+}
+
+void FrogAPI::returnPart( const ServerRequest& req, const string& part ){
+  // hand a part of a streamed reply to req back to the event loop
+  ServerRequest *piece = new ServerRequest();
+  piece->conn_id = req.conn_id;
+  piece->output = part;
+  piece->failed = false;
+  piece->last = false;
+  returnRequest( piece );
+}
+
+// the maximum number of requests in one batch
+const size_t MAX_BATCH = 256;
+
+void FrogAPI::batchThread(){
+  // with --batch-window, this one thread frogs the requests of all
+  // connections. It waits a short while after a request comes in, for
+  // others to join it, and then frogs them as one batch
+  while ( true ){
+    vector<ServerRequest*> batch;
+    {
+      unique_lock<mutex> guard( serverPool->lock );
+      while ( !serverPool->stopping && serverPool->requests.empty() ){
+	serverPool->ready.wait( guard );
+      }
+      auto deadline = chrono::steady_clock::now()
+	+ chrono::milliseconds( options.batchWindow );
+      while ( !serverPool->stopping
+	      && serverPool->requests.size() < MAX_BATCH ){
+	if ( serverPool->ready.wait_until( guard, deadline )
+	     == cv_status::timeout ){
+	  break;
+	}
+      }
+      if ( serverPool->stopping ){
+	break;
+      }
+      while ( !serverPool->requests.empty() && batch.size() < MAX_BATCH ){
+	batch.push_back( serverPool->requests.front() );
+	serverPool->requests.pop_front();
+      }
+    }
+    vector<ServerRequest*> live;
+    for ( const auto& req : batch ){
+      if ( expired( *req, options.requestDeadline ) ){
+	metrics->addRejected();
+	req->output = rejectNotice();
+	returnRequest( req );
+      }
+      else {
+	live.push_back( req );
+      }
+    }
+    if ( live.empty() ){
+      continue;
+    }
+    shared_ptr<FrogAPI> engine = currentEngine();
+    // the engine may be a reloaded one, without a pool. So we send the
+    // streamed parts ourselves
+    auto emit = [&]( const ServerRequest& req, const string& part ){
+      returnPart( req, part );
+    };
+    engine->frogBatch( live, emit );
+    for ( const auto& req : live ){
+      for ( const auto& part : req->parts ){
+	returnPart( *req, part );
+      }
+      req->parts.clear();
+      returnRequest( req );
+    }
+  }
+}
+
+void FrogAPI::frogBatch( const vector<ServerRequest*>& batch,
+			 const function<void(const ServerRequest&,
+					     const string&)>& emit ){
+  // frog the sentences of all requests in batch together, spread over all
+  // workers. So the fixed costs are paid once per batch, and even small
+  // requests keep all workers busy. Then split the results per request,
+  // in the output of every request. With --streaming the results of the
+  // sentences are given to emit while the batch is running, and only a
+  // deadline notice is left in the parts of a request.
+  size_t num = batch.size();
+  vector<Document*> docs( num, 0 );
+  resetTimers();
+  timers.tokTimer.start();
+#pragma omp parallel for schedule(dynamic) num_threads(workers.size())
+  for ( size_t i=0; i < num; ++i ){
+#ifdef HAVE_OPENMP
+    FrogWorker *w = workers[omp_get_thread_num()];
+#else
+    FrogWorker *w = workers[0];
+#endif
+    try {
+      docs[i] = requestDocument( batch[i]->input, w->myTokenizer, w->timers );
+      addDeclarations( *docs[i] );
+    }
+    catch ( std::exception& e ){
+      if ( options.debugFlag ){
+	LOG << "request failed: " << e.what() << endl;
+      }
+      batch[i]->failed = true;
+    }
+  }
+  timers.tokTimer.stop();
+  vector<Sentence*> sentences;
+  // the sentences of request i are sentences[first[i]] up to first[i+1]
+  vector<size_t> first( num + 1, 0 );
+  for ( size_t i=0; i < num; ++i ){
+    first[i] = sentences.size();
+    if ( docs[i] ){
+      vector<Sentence*> part;
+      if ( options.doQuoteDetection ){
+	part = docs[i]->sentenceParts();
+      }
+      else {
+	part = docs[i]->sentences();
+      }
+      sentences.insert( sentences.end(), part.begin(), part.end() );
+    }
+  }
+  first[num] = sentences.size();
+  // the records of the frogged sentences, for the columned output
+  SentenceRecords records;
+  // with --streaming, a sentence is sent as soon as it, and all sentences
+  // before it in its request, are frogged. The workers finish them in any
+  // order, so we keep track of what is done
+  function<void(Sentence*)> done = nullptr;
+  unordered_map<Sentence*,size_t> position;
+  vector<size_t> owner( sentences.size() );
+  vector<bool> finished( sentences.size(), false );
+  vector<size_t> next( first.begin(), first.end() - 1 );
+  if ( options.doStreaming ){
+    for ( size_t i=0; i < num; ++i ){
+      for ( size_t pos = first[i]; pos < first[i+1]; ++pos ){
+	position[sentences[pos]] = pos;
+	owner[pos] = i;
+      }
+    }
+    done = [&]( Sentence *sent ){
+      size_t pos = position.at( sent );
+      size_t i = owner[pos];
+#pragma omp critical(batch_stream)
+      {
+	finished[pos] = true;
+	while ( next[i] < first[i+1] && finished[next[i]] ){
+	  string part;
+	  // other workers may be adding to the same document
+#pragma omp critical(foliaupdate)
+	  {
+	    part = sentenceResults( sentences[next[i]], &records );
+	  }
+	  emit( *batch[i], part );
+	  ++next[i];
+	}
+      }
+    };
+  }
+  LOG << "Processing a batch of " << num << " requests with "
+      << sentences.size() << " sentences" << endl;
+  if ( options.requestDeadline > 0 ){
+    // the whole batch has to obey the most urgent deadline in it
+    auto deadline = batch[0]->arrived;
+    for ( const auto& req : batch ){
+      deadline = min( deadline, req->arrived );
+    }
+    deadline += chrono::milliseconds( options.requestDeadline );
+    for ( const auto& w : workers ){
+      w->setDeadline( deadline );
+    }
+  }
+  else {
+    for ( const auto& w : workers ){
+      w->clearDeadline();
+    }
+  }
+  timers.frogTimer.start();
+  bool all_well = true;
+  try {
+    TestSentences( sentences, 0, done, &records );
+  }
+  catch ( std::exception& e ){
+    LOG << "frogging a batch failed: " << e.what() << endl;
+    all_well = false;
+  }
+  timers.frogTimer.stop();
+  showTimers();
+  if ( metrics && all_well ){
+    size_t ok = 0;
+    size_t tokens = 0;
+    for ( const auto& doc : docs ){
+      if ( doc ){
+	++ok;
+	tokens += doc->words().size();
+      }
+    }
+    metrics->addRequests( ok, sentences.size(), tokens );
+    // one observation for the whole batch: the modules summed over the
+    // workers, and the frog time of the batch itself. (The workers don't
+    // time that, they only frog sentences)
+    TimerBlock total;
+    for ( const auto& w : workers ){
+      total.add( w->timers );
+    }
+    total.frogTimer.reset();
+    total.frogTimer.add( timers.frogTimer );
+    metrics->addTimes( total );
+  }
+  for ( size_t i=0; i < num; ++i ){
+    ServerRequest *req = batch[i];
+    if ( !all_well ){
+      req->failed = true;
+    }
+    if ( !req->failed ){
+      ostringstream outputstream;
+      try {
+	if ( !options.doStreaming ){
+	  // (streamed results are sent already)
+	  requestResults( *docs[i], outputstream, nullptr, &records );
+	}
+	size_t parses = 0;
+	size_t morphs = 0;
+	for ( const auto& w : workers ){
+	  for ( const auto& sent : w->skippedParses ){
+	    if ( sent->doc() == docs[i] ){
+	      ++parses;
+	    }
+	  }
+	  for ( const auto& sent : w->skippedMorphs ){
+	    if ( sent->doc() == docs[i] ){
+	      ++morphs;
+	    }
+	  }
+	}
+	string notice = deadlineNotice( parses, morphs );
+	if ( !notice.empty() ){
+	  if ( options.doStreaming ){
+	    req->parts.push_back( notice );
+	  }
+	  else {
+	    outputstream << notice;
+	  }
+	}
+	req->output = outputstream.str();
+      }
+      catch ( std::exception& e ){
+	LOG << "request failed: " << e.what() << endl;
+	req->failed = true;
+      }
+    }
+    delete docs[i];
+  }
+}
+
+void FrogAPI::FrogServer( Sockets::ServerSocket &conn ){
+  FrogServer( conn, *workers[0] );
+}
+
+void FrogAPI::FrogServer( Sockets::ServerSocket &conn, FrogWorker& w ){
+  // handle all requests on conn, using the modules of worker w
+  try {
+    string data;
+    while (true) {
+      ostringstream outputstream;
+      data.clear();
+      if ( options.doFramed ){
+	if ( !read_frame( conn.getSockId(), data ) ){
+	  throw( runtime_error( "read failed" ) );
+	}
+        if ( options.debugFlag ){
+	  LOG << "Received: [" << data << "]" << endl;
+	}
+      }
+      else if ( options.doXMLin ){
+        string s;
+        while ( conn.read(s) ){
+	  data += s + "\n";
+	  if ( s.empty() )
+	    break;
+        }
+        if ( options.debugFlag ){
+	  LOG << "received data [" << data << "]" << endl;
+	}
+      }
+      else {
+        if ( options.doSentencePerLine ){
+	  if ( !conn.read( data ) ){
+	    //read data from client
+	    throw( runtime_error( "read failed" ) );
+	  }
+	}
+        else {
+	  string line;
+	  while( conn.read(line) ){
+	    if ( line == "EOT" )
+	      break;
+	    data += line + "\n";
+	  }
+        }
+        if ( options.debugFlag ){
+	  LOG << "Received: [" << data << "]" << endl;
+	}
+      }
+      auto emit = [&]( const string& part ){
+	// send a part of a streamed reply right away
+	bool ok = options.doFramed ? write_frame( conn.getSockId(), part )
+	  : conn.write( part );
+	if ( !ok ){
+	  throw( runtime_error( "write to client failed" ) );
+	}
+      };
+      FrogRequest( data, outputstream, w, emit,
+		   chrono::steady_clock::now() );
+      if ( options.doFramed ){
+	// when streaming, the output is empty, and ends the reply
+	if ( !write_frame( conn.getSockId(), outputstream.str() ) ){
+	  throw( runtime_error( "write to client failed" ) );
+	}
+      }
+      else if (!conn.write( (outputstream.str()) ) || !(conn.write("READY\n"))  ){
+	if (options.debugFlag) {
+	  LOG << "socket " << conn.getMessage() << endl;
+	}
+	throw( runtime_error( "write to client failed" ) );
+      }
+    }
+  }
+  catch ( std::exception& e ) {
+    if (options.debugFlag){
+      LOG << "connection lost: " << e.what() << endl;
+    }
+  }
+  LOG << "Connection closed.\n";
+}
+
+Document *FrogAPI::requestDocument( const string& data,
+				    UctoTokenizer *tok,
+				    TimerBlock& t ){
+  // turn the data of one server request into a tokenized document.
+  // throws when the data is unusable
+  Document *doc = 0;
+  if ( options.doXMLin ){
+    if ( data.size() < 50 ){
+      // a FoLia doc must be at least a few 100 bytes
+      // so this is wrong. Just bail out
+      throw( runtime_error( "read garbage" ) );
+    }
+    doc = new Document();
+    try {
+      doc->readFromString( data );
+    }
+    catch ( std::exception& e ){
+      LOG << "FoLiaParsing failed:" << endl << e.what() << endl;
+      delete doc;
+      throw;
+    }
+    t.tokTimer.start();
+    tok->tokenize( *doc );
+    t.tokTimer.stop();
+  }
+  else {
+    istringstream inputstream(data,istringstream::in);
+    t.tokTimer.start();
+    doc = tok->tokenize( inputstream );
+    t.tokTimer.stop();
+  }
+  return doc;
+}
+
+string FrogAPI::sentenceResults( Sentence *sent,
+				 const SentenceRecords *records ) const {
+  // the results for one sentence, for --streaming
+  ostringstream part;
+  const SentenceRecord *rec = records ? records->find( sent ) : 0;
+  if ( options.doXMLout ){
+    part << sent->xmlstring() << endl;
+  }
+  else if ( rec ){
+    formatter->showSentence( part, *rec );
+  }
+  else {
+    formatter->showSentence( part, sent );
+  }
+  return part.str();
+}
+
+void FrogAPI::requestResults( Document& doc,
+			      ostream& outputstream,
+			      const function<void(const string&)>& emit,
+			      const SentenceRecords *records ){
+  // the results for a frogged request. With --streaming they go to emit,
+  // sentence by sentence
+  if ( options.doStreaming ){
+    for ( const auto& sent : doc.sentences() ){
+      emit( sentenceResults( sent, records ) );
+    }
+  }
+  else if ( options.doXMLout ){
+    doc.save( outputstream, options.doKanon );
+  }
+  else {
+    showResults( outputstream, doc, records );
+  }
+}
+
+void FrogAPI::FrogRequest( const string& data,
+			   ostream& outputstream,
+			   FrogWorker& w,
+			   const function<void(const string&)>& emit,
+			   const chrono::steady_clock::time_point& start ){
+  // frog the data of one server request, using the modules of worker w.
+  // throws when the data is unusable.
+  // With --streaming, the results of every sentence are passed to emit as
+  // soon as they are ready, and nothing is written to outputstream
+  // With --deadline, the parser is skipped, and deep morphology replaced by
+  // shallow morphology, once the request is running longer then that,
+  // counting from start
+  w.timers.reset();
+  if ( options.requestDeadline > 0 ){
+    w.setDeadline( start + chrono::milliseconds( options.requestDeadline ) );
+  }
+  else {
+    w.clearDeadline();
+  }
+  Document *doc = requestDocument( data, w.myTokenizer, w.timers );
+  LOG << "Processing... " << endl;
+  SentenceRecords records;
+  try {
+    if ( options.doStreaming ){
+      auto done = [&]( Sentence *sent ){
+	emit( sentenceResults( sent, &records ) );
+      };
+      FrogDoc( *doc, w, done, &records );
+    }
+    else {
+      FrogDoc( *doc, w, nullptr, &records );
+      requestResults( *doc, outputstream, emit, &records );
+    }
+    if ( metrics ){
+      metrics->addRequests( 1, doc->sentences().size(),
+			    doc->words().size() );
+      metrics->addTimes( w.timers );
+    }
+    string notice = deadlineNotice( w.skippedParses.size(),
+				    w.skippedMorphs.size() );
+    if ( !notice.empty() ){
+      if ( options.doStreaming ){
+	emit( notice );
+      }
+      else {
+	outputstream << notice;
+      }
+    }
+  }
+  catch ( ... ){
+    delete doc;
+    throw;
+  }
+  delete doc;
+}
+
+void FrogAPI::FrogDoc( Document& doc,
+		       FrogWorker& w,
+		       const function<void(Sentence*)>& done,
+		       SentenceRecords *records ){
+  w.timers.frogTimer.start();
+  TestDocument( doc, &w, done, records );
+  w.timers.frogTimer.stop();
+  showTimers( w.timers, w.timers );
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+
+struct EventConn {
+  // the state of one client connection in the event loop.
+  // An idle connection only holds a few (empty) buffers
+  int fd;
+  string inbuf;  // received data, not yet taken as a request
+  string outbuf; // replies, not yet sent
+  size_t outpos; // what is sent of outbuf
+  bool busy;     // one of its requests is queued or being frogged
+  bool eof;      // the client stopped sending
+  bool failed;   // a read or write failed, or the request was garbage
+  bool blocked;  // waiting for room in the request queue
+  ServerRequest *waiting; // the request that waits for that room
+  uint32_t events; // what we listen for with epoll
+};
+
+class EventLoop {
+  // multiplexes all client connections on one thread with epoll.
+  // Complete requests are handed to the server threads one at a time per
+  // connection, so the replies keep the order of the requests.
+  // Replies are sent when the socket is ready for them.
+ public:
+  EventLoop( ServerPool&, const FrogOptions&, TiCC::LogStream * );
+  ~EventLoop();
+  bool init( int );
+  void run( volatile sig_atomic_t&, volatile sig_atomic_t&,
+	    const function<void()>& );
+ private:
+  void accept_all();
+  void read_conn( size_t, EventConn& );
+  void flush_conn( size_t, EventConn& );
+  void send_reply( size_t, EventConn&, const string&, bool );
+  size_t frame_missing( const EventConn& ) const;
+  void collect_done();
+  void service( size_t );
+  bool queue_request( EventConn& );
+  void update_events( size_t, EventConn& );
+  bool next_request( EventConn&, string& ) const;
+  ServerPool& pool;
+  const FrogOptions& options;
+  TiCC::LogStream *theErrLog;
+  int epfd;
+  int listen_fd;
+  unordered_map<size_t,EventConn*> conns;
+  deque<size_t> blocked; // connections waiting for room in the queue
+  size_t next_id;
+  vector<char> buffer;
+};
+
+// the epoll ids of the listening socket and the wakeup fd
+// connections get ids from 2 on, which are never reused
+const size_t LISTEN_ID = 0;
+const size_t WAKEUP_ID = 1;
+
+EventLoop::EventLoop( ServerPool& p,
+		      const FrogOptions& opts,
+		      TiCC::LogStream *log ):
+  pool(p),
+  options(opts),
+  theErrLog(log),
+  epfd(-1),
+  listen_fd(-1),
+  next_id(2),
+  buffer(65536)
+{}
+
+EventLoop::~EventLoop(){
+  for ( const auto& it : conns ){
+    ::close( it.second->fd );
+    delete it.second->waiting;
+    delete it.second;
+  }
+  if ( epfd >= 0 ){
+    ::close( epfd );
+  }
+}
+
+bool EventLoop::init( int fd ){
+  listen_fd = fd;
+  epfd = epoll_create1( EPOLL_CLOEXEC );
+  pool.wakeup_fd = eventfd( 0, EFD_NONBLOCK|EFD_CLOEXEC );
+  if ( epfd < 0 || pool.wakeup_fd < 0 ){
+    LOG << "unable to set up the event loop: " << strerror(errno) << endl;
+    return false;
+  }
+  int flags = fcntl( listen_fd, F_GETFL, 0 );
+  fcntl( listen_fd, F_SETFL, flags | O_NONBLOCK );
+  epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.u64 = LISTEN_ID;
+  if ( epoll_ctl( epfd, EPOLL_CTL_ADD, listen_fd, &ev ) < 0 ){
+    LOG << "epoll on listening socket failed: " << strerror(errno) << endl;
+    return false;
+  }
+  ev.events = EPOLLIN;
+  ev.data.u64 = WAKEUP_ID;
+  if ( epoll_ctl( epfd, EPOLL_CTL_ADD, pool.wakeup_fd, &ev ) < 0 ){
+    LOG << "epoll on wakeup fd failed: " << strerror(errno) << endl;
+    return false;
+  }
+  return true;
+}
+
+void EventLoop::run( volatile sig_atomic_t& running,
+		     volatile sig_atomic_t& reload,
+		     const function<void()>& do_reload ){
+  // serve until running goes 0. When reload is set, call do_reload.
+  // Both are set from signal handlers
+  const int max_events = 64;
+  epoll_event events[max_events];
+  while ( running ){
+    if ( reload ){
+      reload = 0;
+      do_reload();
+    }
+    // wake up now and then, as a signal may hit another thread
+    int n = epoll_wait( epfd, events, max_events, 1000 );
+    if ( n < 0 ){
+      if ( errno == EINTR ){
+	continue;
+      }
+      throw runtime_error( string("epoll_wait failed: ") + strerror(errno) );
+    }
+    for ( int i=0; i < n; ++i ){
+      size_t id = events[i].data.u64;
+      if ( id == LISTEN_ID ){
+	accept_all();
+      }
+      else if ( id == WAKEUP_ID ){
+	collect_done();
+      }
+      else {
+	auto it = conns.find( id );
+	if ( it == conns.end() ){
+	  continue;
+	}
+	EventConn& conn = *it->second;
+	if ( events[i].events & (EPOLLIN|EPOLLHUP|EPOLLRDHUP|EPOLLERR) ){
+	  read_conn( id, conn );
+	}
+	if ( events[i].events & EPOLLOUT ){
+	  flush_conn( id, conn );
+	}
+	service( id );
+      }
+    }
+  }
+}
+
+void EventLoop::accept_all(){
+  while ( true ){
+    int fd = accept4( listen_fd, 0, 0, SOCK_NONBLOCK|SOCK_CLOEXEC );
+    if ( fd < 0 ){
+      if ( errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR ){
+	LOG << "accept failed: " << strerror(errno) << endl;
+      }
+      return;
+    }
+    EventConn *conn = new EventConn();
+    conn->fd = fd;
+    conn->outpos = 0;
+    conn->busy = false;
+    conn->eof = false;
+    conn->failed = false;
+    conn->blocked = false;
+    conn->waiting = 0;
+    conn->events = EPOLLIN|EPOLLRDHUP;
+    size_t id = next_id++;
+    epoll_event ev;
+    ev.events = EPOLLIN|EPOLLRDHUP;
+    ev.data.u64 = id;
+    if ( epoll_ctl( epfd, EPOLL_CTL_ADD, fd, &ev ) < 0 ){
+      LOG << "epoll on new connection failed: " << strerror(errno) << endl;
+      ::close( fd );
+      delete conn;
+      continue;
+    }
+    conns[id] = conn;
+    pool.metrics.connectionOpened();
+    LOG << "New connection..." << endl;
+  }
+}
+
+size_t EventLoop::frame_missing( const EventConn& conn ) const {
+  // the number of bytes still missing for the frame at the start of the
+  // input of conn, or 0 when that isn't known yet
+  if ( !options.doFramed || conn.inbuf.size() < FRAME_HEADER ){
+    return 0;
+  }
+  size_t len = get_frame_length( conn.inbuf.data() );
+  if ( len > MAX_FRAME || FRAME_HEADER + len <= conn.inbuf.size() ){
+    return 0;
+  }
+  return FRAME_HEADER + len - conn.inbuf.size();
+}
+
+void EventLoop::read_conn( size_t id, EventConn& conn ){
+  // read all that is available, in chunks of our shared buffer.
+  // The rest of a frame of known length is read straight into the input
+  // of conn, in one recv when the data is there
+  while ( !conn.eof && !conn.failed ){
+    ssize_t len;
+    size_t missing = frame_missing( conn );
+    if ( missing > 0 ){
+      size_t old = conn.inbuf.size();
+      conn.inbuf.resize( old + missing );
+      len = ::recv( conn.fd, &conn.inbuf[old], missing, 0 );
+      conn.inbuf.resize( old + ( len > 0 ? len : 0 ) );
+    }
+    else {
+      len = ::recv( conn.fd, &buffer[0], buffer.size(), 0 );
+      if ( len > 0 ){
+	conn.inbuf.append( &buffer[0], len );
+      }
+    }
+    if ( len > 0 ){
+      // go on
+    }
+    else if ( len == 0 ){
+      conn.eof = true;
+    }
+    else if ( errno == EINTR ){
+      continue;
+    }
+    else {
+      if ( errno != EAGAIN && errno != EWOULDBLOCK ){
+	if ( options.debugFlag ){
+	  LOG << "connection " << id << " lost: " << strerror(errno) << endl;
+	}
+	conn.failed = true;
+      }
+      break;
+    }
+  }
+}
+
+void EventLoop::flush_conn( size_t id, EventConn& conn ){
+  // send as much of the pending replies as the socket takes. When it
+  // doesn't take all, we wait for EPOLLOUT
+  while ( conn.outpos < conn.outbuf.size() && !conn.failed ){
+    ssize_t len = ::send( conn.fd,
+			  conn.outbuf.data() + conn.outpos,
+			  conn.outbuf.size() - conn.outpos,
+			  MSG_NOSIGNAL );
+    if ( len >= 0 ){
+      conn.outpos += len;
+    }
+    else if ( errno == EINTR ){
+      continue;
+    }
+    else {
+      if ( errno != EAGAIN && errno != EWOULDBLOCK ){
+	if ( options.debugFlag ){
+	  LOG << "write to client failed: " << strerror(errno) << endl;
+	}
+	conn.failed = true;
+      }
+      break;
+    }
+  }
+  bool pending = conn.outpos < conn.outbuf.size();
+  if ( !pending ){
+    // release the memory of big replies
+    string().swap( conn.outbuf );
+    conn.outpos = 0;
+  }
+  update_events( id, conn );
+}
+
+void EventLoop::update_events( size_t id, EventConn& conn ){
+  // only read from conn when we may take a new request from it. So a
+  // client that sends faster than we frog is slowed down by TCP itself,
+  // and doesn't fill our memory
+  uint32_t events = 0;
+  if ( !conn.failed ){
+    if ( !conn.eof ){
+      events |= EPOLLRDHUP;
+      if ( !conn.busy && !conn.waiting ){
+	events |= EPOLLIN;
+      }
+    }
+    if ( conn.outpos < conn.outbuf.size() ){
+      events |= EPOLLOUT;
+    }
+  }
+  if ( events == conn.events ){
+    return;
+  }
+  epoll_event ev;
+  ev.events = events;
+  ev.data.u64 = id;
+  if ( events == 0 ){
+    // not even for hangups, as they would wake us up over and over again
+    epoll_ctl( epfd, EPOLL_CTL_DEL, conn.fd, 0 );
+  }
+  else if ( conn.events == 0 ){
+    epoll_ctl( epfd, EPOLL_CTL_ADD, conn.fd, &ev );
+  }
+  else {
+    epoll_ctl( epfd, EPOLL_CTL_MOD, conn.fd, &ev );
+  }
+  conn.events = events;
+}
+
+bool EventLoop::queue_request( EventConn& conn ){
+  // move the waiting request of conn to the request queue, when there is
+  // room for it
+  {
+    lock_guard<mutex> guard( pool.lock );
+    if ( options.maxQueue > 0 && pool.requests.size() >= options.maxQueue ){
+      return false;
+    }
+    pool.requests.push_back( conn.waiting );
+  }
+  pool.ready.notify_one();
+  conn.waiting = 0;
+  conn.busy = true;
+  return true;
+}
+
+void EventLoop::send_reply( size_t id,
+			    EventConn& conn,
+			    const string& reply,
+			    bool last ){
+  // send a reply with its frame header or READY line in one gather write.
+  // Parts of a streamed reply (last is false) get no READY line.
+  // What the socket doesn't take now is queued, and sent on EPOLLOUT
+  char header[FRAME_HEADER];
+  iovec iov[2];
+  if ( options.doFramed ){
+    set_frame_length( header, reply.size() );
+    iov[0].iov_base = header;
+    iov[0].iov_len = FRAME_HEADER;
+    iov[1].iov_base = const_cast<char*>( reply.data() );
+    iov[1].iov_len = reply.size();
+  }
+  else {
+    static const char *ready = "READY\n";
+    iov[0].iov_base = const_cast<char*>( reply.data() );
+    iov[0].iov_len = reply.size();
+    iov[1].iov_base = const_cast<char*>( ready );
+    iov[1].iov_len = last ? 6 : 0;
+  }
+  size_t sent = 0;
+  if ( conn.outpos >= conn.outbuf.size() ){
+    // nothing queued before it
+    msghdr msg;
+    memset( &msg, 0, sizeof(msg) );
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    ssize_t len;
+    do {
+      len = ::sendmsg( conn.fd, &msg, MSG_NOSIGNAL );
+    } while ( len < 0 && errno == EINTR );
+    if ( len >= 0 ){
+      sent = len;
+    }
+    else if ( errno != EAGAIN && errno != EWOULDBLOCK ){
+      if ( options.debugFlag ){
+	LOG << "write to client failed: " << strerror(errno) << endl;
+      }
+      conn.failed = true;
+      return;
+    }
+  }
+  for ( int i=0; i < 2; ++i ){
+    if ( sent >= iov[i].iov_len ){
+      sent -= iov[i].iov_len;
+    }
+    else {
+      conn.outbuf.append( static_cast<const char*>(iov[i].iov_base) + sent,
+			  iov[i].iov_len - sent );
+      sent = 0;
+    }
+  }
+  if ( conn.outpos < conn.outbuf.size() ){
+    flush_conn( id, conn );
+  }
+}
+
+void EventLoop::collect_done(){
+  uint64_t count;
+  while ( ::read( pool.wakeup_fd, &count, sizeof(count) ) > 0 ){
+    // just drain it
+  }
+  deque<ServerRequest*> done;
+  {
+    lock_guard<mutex> guard( pool.lock );
+    done.swap( pool.done );
+  }
+  for ( const auto& req : done ){
+    auto it = conns.find( req->conn_id );
+    if ( it != conns.end() ){
+      EventConn& conn = *it->second;
+      if ( req->last ){
+	conn.busy = false;
+      }
+      if ( req->failed ){
+	conn.failed = true;
+      }
+      else {
+	send_reply( req->conn_id, conn, req->output, req->last );
+      }
+      service( req->conn_id );
+    }
+    delete req;
+  }
+  // the server threads made room in the queue. Let the blocked
+  // connections in, in turn
+  while ( !blocked.empty() ){
+    auto it = conns.find( blocked.front() );
+    if ( it != conns.end() ){
+      EventConn& conn = *it->second;
+      if ( conn.waiting && !queue_request( conn ) ){
+	break;
+      }
+      conn.blocked = false;
+      update_events( it->first, conn );
+    }
+    blocked.pop_front();
+  }
+}
+
+bool EventLoop::next_request( EventConn& conn, string& data ) const {
+  // take the first complete request from the input of conn, using the
+  // same conventions as the blocking server. Like that server, we take
+  // what is left when the client stops sending as a last request, also
+  // without an EOT or a final newline
+  data.clear();
+  size_t pos = 0;
+  if ( options.doFramed ){
+    if ( conn.inbuf.size() < FRAME_HEADER ){
+      return false;
+    }
+    size_t len = get_frame_length( conn.inbuf.data() );
+    if ( len > MAX_FRAME ){
+      LOG << "frame too large: " << len << endl;
+      conn.failed = true;
+      return false;
+    }
+    if ( conn.inbuf.size() < FRAME_HEADER + len ){
+      return false;
+    }
+    data.assign( conn.inbuf, FRAME_HEADER, len );
+    pos = FRAME_HEADER + len;
+  }
+  while ( !options.doFramed ){
+    size_t eol = conn.inbuf.find( '\n', pos );
+    if ( eol == string::npos ){
+      if ( !conn.eof ){
+	data.clear();
+	return false;
+      }
+      string line = conn.inbuf.substr( pos );
+      if ( !line.empty() && line.back() == '\r' ){
+	line.pop_back();
+      }
+      if ( !line.empty() ){
+	if ( options.doSentencePerLine ){
+	  data = line;
+	}
+	else {
+	  data += line + "\n";
+	}
+      }
+      pos = conn.inbuf.size();
+      if ( data.find_first_not_of( " \t\r\n" ) == string::npos ){
+	// nothing left to frog
+	data.clear();
+	string().swap( conn.inbuf );
+	return false;
+      }
+      break;
+    }
+    size_t end = eol;
+    if ( end > pos && conn.inbuf[end-1] == '\r' ){
+      --end;
+    }
+    string line = conn.inbuf.substr( pos, end - pos );
+    pos = eol + 1;
+    if ( options.doXMLin ){
+      data += line + "\n";
+      if ( line.empty() ){
+	break;
+      }
+    }
+    else if ( options.doSentencePerLine ){
+      data = line;
+      break;
+    }
+    else if ( line == "EOT" ){
+      break;
+    }
+    else {
+      data += line + "\n";
+    }
+  }
+  conn.inbuf.erase( 0, pos );
+  if ( conn.inbuf.empty() ){
+    string().swap( conn.inbuf );
+  }
+  return true;
+}
+
+void EventLoop::service( size_t id ){
+  // start the next request of connection id, or close it when done
+  auto it = conns.find( id );
+  if ( it == conns.end() ){
+    return;
+  }
+  EventConn& conn = *it->second;
+  if ( conn.failed && conn.waiting ){
+    delete conn.waiting;
+    conn.waiting = 0;
+  }
+  if ( !conn.busy && !conn.failed && !conn.waiting ){
+    string data;
+    if ( next_request( conn, data ) ){
+      if ( options.debugFlag ){
+	LOG << "Received: [" << data << "]" << endl;
+      }
+      ServerRequest *req = new ServerRequest();
+      req->conn_id = id;
+      req->input = data;
+      req->arrived = chrono::steady_clock::now();
+      req->failed = false;
+      req->last = true;
+      conn.waiting = req;
+    }
+  }
+  if ( conn.waiting && !conn.blocked && !queue_request( conn ) ){
+    // the queue is full, wait for the server threads to catch up
+    conn.blocked = true;
+    blocked.push_back( id );
+  }
+  update_events( id, conn );
+  if ( conn.busy || conn.waiting ){
+    // wait for the reply, even when the client is gone
+    return;
+  }
+  if ( conn.failed
+       || ( conn.eof && conn.outpos >= conn.outbuf.size() ) ){
+    if ( conn.events != 0 ){
+      epoll_ctl( epfd, EPOLL_CTL_DEL, conn.fd, 0 );
+    }
+    ::close( conn.fd );
+    delete it->second;
+    conns.erase( it );
+    pool.metrics.connectionClosed();
+    LOG << "Connection closed.\n";
+  }
+}
+
+#endif // HAVE_SYS_EPOLL_H
+
+void FrogAPI::runServer( Sockets::ServerSocket& server,
+			 volatile sig_atomic_t& running,
+			 volatile sig_atomic_t& reload ){
+  // serve clients on the listening socket server, until running goes 0.
+  // When reload is set, load the models again (see reloadModels())
+  startServer();
+#ifdef HAVE_SYS_EPOLL_H
+  // one thread multiplexes all connections, the server threads only frog
+  try {
+    EventLoop loop( *serverPool, options, theErrLog );
+    if ( !loop.init( server.getSockId() ) ){
+      throw runtime_error( "starting the event loop failed" );
+    }
+    loop.run( running, reload, [this](){ reloadModels(); } );
+  }
+  catch ( ... ){
+    stopServer();
+    throw;
+  }
+  stopServer();
+#else
+  // every connection occupies a server thread while it is open
+  while ( running ) {
+    if ( reload ){
+      reload = 0;
+      reloadModels();
+    }
+    // wait for a connection, but wake up now and then: a signal may hit
+    // one of the other threads, and then it doesn't interrupt the accept
+    pollfd listener;
+    listener.fd = server.getSockId();
+    listener.events = POLLIN;
+    listener.revents = 0;
+    int n = poll( &listener, 1, 1000 );
+    if ( n < 0 && errno != EINTR ){
+      stopServer();
+      throw runtime_error( string("poll failed: ") + strerror(errno) );
+    }
+    if ( n <= 0 ){
+      continue;
+    }
+    Sockets::ServerSocket *conn = new Sockets::ServerSocket();
+    if ( server.accept( *conn ) ){
+      LOG << "New connection..." << endl;
+      serveConnection( conn );
+    }
+    else {
+      delete conn;
+      if ( !running ){
+	break;
+      }
+      if ( reload ){
+	continue;
+      }
+      stopServer();
+      throw( runtime_error( "Accept failed" ) );
+    }
+  }
+  stopServer();
+#endif
+}
@@ -31,6 +31,11 @@
 
 #include <set>
 #include <string>
+#include <stdexcept>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <ctime>
 #include "config.h"
 #include "frog/Frog.h"
 
@@ -42,6 +47,74 @@
 
 using namespace std;
 
+// the measurements started by this thread, and not yet stopped
+struct TimerStart {
+  const ModuleTimer *timer;
+  chrono::steady_clock::time_point wall;
+  long long cpu;
+};
+static thread_local vector<TimerStart> running_timers;
+
+static long long thread_cpu_ns(){
+  timespec ts;
+  if ( clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts ) != 0 ){
+    return 0;
+  }
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void ModuleTimer::start(){
+  running_timers.push_back( TimerStart{ this,
+					chrono::steady_clock::now(),
+					thread_cpu_ns() } );
+}
+
+void ModuleTimer::stop( size_t toks ){
+  // add the measurement of this thread to the totals. toks is the number
+  // of tokens handled, when known
+  auto it = running_timers.end();
+  while ( it != running_timers.begin() ){
+    --it;
+    if ( it->timer == this ){
+      auto wall = chrono::steady_clock::now() - it->wall;
+      wall_ns += chrono::duration_cast<chrono::nanoseconds>( wall ).count();
+      cpu_ns += thread_cpu_ns() - it->cpu;
+      ++num_calls;
+      num_tokens += toks;
+      running_timers.erase( it );
+      return;
+    }
+  }
+  // not started by this thread, so there is nothing to add
+}
+
+void ModuleTimer::reset(){
+  wall_ns = 0;
+  cpu_ns = 0;
+  num_calls = 0;
+  num_tokens = 0;
+}
+
+void ModuleTimer::add( const ModuleTimer& mt ){
+  wall_ns += mt.wall_ns.load();
+  cpu_ns += mt.cpu_ns.load();
+  num_calls += mt.num_calls.load();
+  num_tokens += mt.num_tokens.load();
+}
+
+ostream& operator<<( ostream& os, const ModuleTimer& timer ){
+  // the wall clock time in the format TiCC::Timer uses, then the rest
+  long long usecs = static_cast<long long>( timer.secs() * 1000000 );
+  os << usecs / 1000000 << " seconds, " << (usecs / 1000) % 1000
+     << " milliseconds and " << usecs % 1000 << " microseconds"
+     << " (cpu: " << timer.cpuSecs() << " s, " << timer.calls() << " calls";
+  if ( timer.tokens() > 0 ){
+    os << ", " << timer.tokens() << " tokens";
+  }
+  os << ")";
+  return os;
+}
+
 string prefix( const string& path, const string& fn ){
   if ( fn.find( "/" ) == string::npos && !path.empty() ){
     // only append prefix when it isn't empty AND
@@ -91,3 +164,74 @@ string getTime() {
   string res = buf;
   return res;
 }
+
+void AnnotationBuffer::commit(){
+  // apply all collected updates in one step. The FoLiA Document keeps one
+  // index of id's for all sentences, so a short lock per commit is still
+  // needed when several sentences are committed at the same time.
+  if ( updates.empty() ){
+    return;
+  }
+  string error;
+#pragma omp critical(foliaupdate)
+  {
+    try {
+      for ( const auto& update : updates ){
+	update();
+      }
+    }
+    catch ( exception& e ){
+      error = e.what();
+    }
+  }
+  updates.clear();
+  if ( !error.empty() ){
+    throw runtime_error( error );
+  }
+}
+
+void SentenceRecord::fill( const vector<folia::Word*>& ws,
+			   const string& textclass ){
+  words = ws;
+  size_t n = words.size();
+  text.clear();
+  token_class.clear();
+  text.reserve( n );
+  token_class.reserve( n );
+  for ( const auto& word : words ){
+    text.push_back( word->text( textclass ) );
+    token_class.push_back( word->cls() );
+  }
+  tags.assign( n, "" );
+  heads.assign( n, "" );
+  features.assign( n, vector<string>() );
+  confidences.assign( n, 1.0 );
+  lemmas.assign( n, "" );
+  morphs.assign( n, vector<string>() );
+  compounds.assign( n, vector<string>() );
+  chunks.assign( n, "" );
+  entities.assign( n, "" );
+  mwus.clear();
+  dep_heads.clear();
+  dep_rels.clear();
+}
+
+void SentenceRecords::add( folia::Sentence *sent, SentenceRecord&& rec ){
+#pragma omp critical(sentence_records)
+  {
+    records[sent] = std::move( rec );
+  }
+}
+
+const SentenceRecord *SentenceRecords::find( folia::Sentence *sent ) const {
+  // the record of sent, or 0 when it isn't frogged (as a whole)
+  const SentenceRecord *result = 0;
+#pragma omp critical(sentence_records)
+  {
+    const auto it = records.find( sent );
+    if ( it != records.end() ){
+      result = &it->second;
+    }
+  }
+  return result;
+}
@@ -107,7 +107,7 @@ void usage( ) {
        << "\t --uttmarker=<mark>     utterances are separated by 'mark' symbols"
        << "\t                        (default none)\n"
        << "\t -n                     Assume input file to hold one sentence per line\n"
-       << "\t --max-parser-tokens=<n> inhibit parsing when a sentence contains over 'n' tokens. (default: 500, needs already 16Gb of memory!)\n"
+       << "\t --max-parser-tokens=<n> inhibit parsing when a sentence contains over 'n' tokens. (default: 500)\n"
        << "\t -Q                   Enable quote detection in tokeniser.\n"
        << "\t============= MODULE SELECTION ==========================================\n"
        << "\t --skip=[mptncla]    Skip Tokenizer (t), Lemmatizer (l), Morphological Analyzer (a), Chunker (c), Multi-Word Units (m), Named Entity Recognition (n), or Parser (p) \n"
@@ -130,10 +130,32 @@ void usage( ) {
        << "\t --debug=<module><level>,<module><level>... (eg --debug=l5,n3) \n"
        << "\t\t Set debug value for Tokenizer (t), Lemmatizer (l), Morphological Analyzer (a), Chunker (c), Multi-Word Units (m), Named Entity Recognition (n), or Parser (p) \n"
        << "\t -S <port>              Run as server instead of reading from testfile\n"
+       << "\t --framed               In server mode, send requests and replies as\n"
+       << "\t                        a 4 byte length followed by UTF-8 text.\n"
+       << "\t --streaming            In server mode, send the results of every\n"
+       << "\t                        sentence as soon as it is done.\n"
+       << "\t --batch-window=<ms>     In server mode, collect the requests that\n"
+       << "\t                        arrive within 'ms' milliseconds, and frog\n"
+       << "\t                        them together. Default: 0 (no batching)\n"
+       << "\t --deadline=<ms>        In server mode, skip the parser and give\n"
+       << "\t                        shallow instead of deep morphology for\n"
+       << "\t                        requests that take longer then 'ms'\n"
+       << "\t                        milliseconds. Default: 0 (none)\n"
+       << "\t --max-queue=<n>        In server mode, don't accept more than 'n'\n"
+       << "\t                        waiting requests. Default: 0 (no limit)\n"
+       << "\t --metrics=<file>       In server mode, write throughput, latency\n"
+       << "\t                        and load figures to 'file' every second\n"
 #ifdef HAVE_OPENMP
        << "\t --threads=<n>       Use a maximum of 'n' threads. Default: 8. \n"
+       << "\t                     (in server mode: per request. Default: 1)\n"
+       << "\t --workers=<n>       Frog 'n' sentences in parallel, each worker using\n"
+       << "\t                     its own copy of the taggers. Default: 1. \n"
+       << "\t                     With several input files, every worker\n"
+       << "\t                     frogs whole files instead.\n"
+       << "\t                     In server mode, every worker handles one\n"
+       << "\t                     request at a time. Default: 4.\n"
 #endif
-       << "\t                     (but always 1 for server mode)\n";
+    ;
 }
 
 bool parse_args( TiCC::CL_Options& Opts,
@@ -291,14 +313,61 @@ bool parse_args( TiCC::CL_Options& Opts,
   }
 
   options.doServer = Opts.extract('S', options.listenport );
+  options.doFramed = Opts.extract( "framed" );
+  if ( options.doFramed && !options.doServer ){
+    LOG << "--framed is only useful in server mode (-S). Ignored" << endl;
+    options.doFramed = false;
+  }
+  if ( Opts.extract( "batch-window", value ) ){
+    if ( !stringTo<unsigned int>( value, options.batchWindow ) ){
+      LOG << "batch-window value should be an integer" << endl;
+      return false;
+    }
+    if ( !options.doServer ){
+      LOG << "--batch-window is only useful in server mode (-S). Ignored"
+	  << endl;
+      options.batchWindow = 0;
+    }
+  }
+  if ( Opts.extract( "deadline", value ) ){
+    if ( !stringTo<unsigned int>( value, options.requestDeadline ) ){
+      LOG << "deadline value should be an integer" << endl;
+      return false;
+    }
+    if ( !options.doServer ){
+      LOG << "--deadline is only useful in server mode (-S). Ignored"
+	  << endl;
+      options.requestDeadline = 0;
+    }
+  }
+  if ( Opts.extract( "max-queue", value ) ){
+    if ( !stringTo<unsigned int>( value, options.maxQueue ) ){
+      LOG << "max-queue value should be an integer" << endl;
+      return false;
+    }
+    if ( !options.doServer ){
+      LOG << "--max-queue is only useful in server mode (-S). Ignored"
+	  << endl;
+      options.maxQueue = 0;
+    }
+  }
+  if ( Opts.extract( "metrics", value ) ){
+    if ( !options.doServer ){
+      LOG << "--metrics is only useful in server mode (-S). Ignored"
+	  << endl;
+    }
+    else {
+      options.metricsFile = value;
+    }
+  }
+  options.doStreaming = Opts.extract( "streaming" );
+  if ( options.doStreaming && !options.doServer ){
+    LOG << "--streaming is only useful in server mode (-S). Ignored" << endl;
+    options.doStreaming = false;
+  }
 
 #ifdef HAVE_OPENMP
-  if ( options.doServer ) {
-    // run in one thread in server mode, forking is too expensive for lots of small snippets
-    options.numThreads =  1;
-    Opts.extract( "threads", value ); //discard threads option
-  }
-  else if ( Opts.extract( "threads", value ) ){
+  if ( Opts.extract( "threads", value ) ){
     int num;
     if ( !stringTo<int>( value, num ) || num < 1 ){
       LOG << "threads value should be a positive integer" << endl;
@@ -306,12 +375,33 @@ bool parse_args( TiCC::CL_Options& Opts,
     }
     options.numThreads = num;
   }
+  else if ( options.doServer ){
+    // in server mode, every request runs on one thread by default
+    options.numThreads = 1;
+  }
+  if ( Opts.extract( "workers", value ) ){
+    int num;
+    if ( !stringTo<int>( value, num ) || num < 1 ){
+      LOG << "workers value should be a positive integer" << endl;
+      return false;
+    }
+    options.numWorkers = num;
+  }
+  else if ( options.doServer ){
+    // in server mode, the workers handle the connections. Use a few
+    options.numWorkers = 4;
+  }
 #else
   if ( Opts.extract( "threads", value ) ){
     LOG << "WARNING!\n---> There is NO OpenMP support enabled\n"
 		    << "---> --threads=" << value << " is ignored.\n"
 		    << "---> Will continue on just 1 thread." << endl;
   }
+  if ( Opts.extract( "workers", value ) ){
+    LOG << "WARNING!\n---> There is NO OpenMP support enabled\n"
+		    << "---> --workers=" << value << " is ignored.\n"
+		    << "---> Will continue with just 1 worker." << endl;
+  }
 #endif
 
   if ( Opts.extract( "keep-parser-files" ) ){
@@ -474,13 +564,22 @@ bool parse_args( TiCC::CL_Options& Opts,
   return true;
 }
 
-bool StillRunning = true;
+// set from the signal handlers, so they must be sig_atomic_t
+volatile sig_atomic_t StillRunning = 1;
+volatile sig_atomic_t ReloadModels = 0;
 
 void KillServerFun( int Signal ){
   if ( Signal == SIGTERM ){
     cerr << "KillServerFun caught a signal SIGTERM" << endl;
-    sleep(5); // give children some spare time...
-    StillRunning = false;
+    sleep(5); // give the server threads some spare time...
+    StillRunning = 0;
+  }
+}
+
+void ReloadServerFun( int Signal ){
+  if ( Signal == SIGHUP ){
+    // the server loads the models again, in the background
+    ReloadModels = 1;
   }
 }
 
@@ -506,7 +605,9 @@ int main(int argc, char *argv[]) {
 			  "uttmarker:,max-parser-tokens:,"
 			  "skip:,id:,outputdir:,xmldir:,tmpdir:,deep-morph,"
 			  "help,language:,"
-			  "debug:,keep-parser-files,version,threads:,KANON");
+			  "debug:,keep-parser-files,version,threads:,workers:,KANON,"
+			  "framed,streaming,batch-window:,deadline:,max-queue:,"
+			  "metrics:");
     Opts.init(argc, argv);
     if ( Opts.is_present('V' ) || Opts.is_present("version" ) ){
       // we already did show what we wanted.
@@ -527,7 +628,7 @@ int main(int argc, char *argv[]) {
       string outPath = outputDirName;
       string xmlPath = xmlDirName;
 
-      ostream *outS = 0;
+      ostream *outS = &cout;
       if ( !outputFileName.empty() ){
 	if ( !TiCC::createPath( outputFileName ) ) {
 	  LOG << "problem: unable to create outputfile: "
@@ -539,6 +640,7 @@ int main(int argc, char *argv[]) {
       if ( fileNames.size() > 1 ){
 	LOG << "start procesessing " << fileNames.size() << " files..." << endl;
       }
+      vector<FrogJob> jobs;
       for ( auto const& name : fileNames ){
 	string testName = testDirName + name;
 	if ( !TiCC::isFile( testName ) ){
@@ -547,24 +649,19 @@ int main(int argc, char *argv[]) {
 	  continue;
 	}
 	string outName;
-	if ( outS == 0 ){
-	  if ( wantOUT ){
-	    if ( options.doXMLin ){
-	      if ( !outPath.empty() )
-		outName = outPath + name + ".out";
-	    }
-	    else {
+	if ( outputFileName.empty() && wantOUT ){
+	  if ( options.doXMLin ){
+	    if ( !outPath.empty() )
 	      outName = outPath + name + ".out";
-	    }
-	    if ( !TiCC::createPath( outName ) ) {
-	      LOG << "problem frogging: " << name << endl
-			      << "unable to create outputfile: " << outName
-			      << endl;
-	      continue;
-	    }
-	    outS = new ofstream( outName );
-	  } else {
-	    outS = &cout;
+	  }
+	  else {
+	    outName = outPath + name + ".out";
+	  }
+	  if ( !TiCC::createPath( outName ) ) {
+	    LOG << "problem frogging: " << name << endl
+			    << "unable to create outputfile: " << outName
+			    << endl;
+	    continue;
 	  }
 	}
 	string xmlOutName = XMLoutFileName;
@@ -584,40 +681,30 @@ int main(int argc, char *argv[]) {
 			  << endl;
 	  continue;
 	}
-	LOG << "Frogging " << testName << endl;
-	try {
-	  frog.FrogFile( testName, *outS, xmlOutName );
-	}
-	catch ( exception& e ){
-	  LOG << "problem frogging: " << name << endl
-			  << e.what() << endl;
-	  continue;
-	}
-	if ( !outName.empty() ){
-	  LOG << "results stored in " << outName << endl;
-	  delete outS;
-	  outS = 0;
-	}
+	FrogJob job;
+	job.inName = testName;
+	job.outName = outName;
+	job.xmlName = xmlOutName;
+	jobs.push_back( job );
       }
+      // with more then 1 worker, the files are frogged in parallel
+      frog.FrogFiles( jobs, *outS );
       if ( !outputFileName.empty() ){
 	LOG << "results stored in " << outputFileName << endl;
 	delete outS;
       }
     }
     else if ( options.doServer ) {
-      //first set up some things to deal with zombies
-      struct sigaction action;
-      action.sa_handler = SIG_IGN;
-      sigemptyset(&action.sa_mask);
-#ifdef SA_NOCLDWAIT
-      action.sa_flags = SA_NOCLDWAIT;
-#endif
-      sigaction(SIGCHLD, &action, NULL);
       struct sigaction act;
       sigaction( SIGTERM, NULL, &act ); // get current action
       act.sa_handler = KillServerFun;
       act.sa_flags &= ~SA_RESTART;      // do not continue after SIGTERM
       sigaction( SIGTERM, &act, NULL );
+      struct sigaction hup;
+      sigaction( SIGHUP, NULL, &hup );
+      hup.sa_handler = ReloadServerFun;
+      hup.sa_flags &= ~SA_RESTART;
+      sigaction( SIGHUP, &hup, NULL );
 
       srand((unsigned)time(0));
 
@@ -628,29 +715,11 @@ int main(int argc, char *argv[]) {
 	Sockets::ServerSocket server;
 	if ( !server.connect( options.listenport ) )
 	  throw( runtime_error( "starting server on port " + options.listenport + " failed" ) );
-	if ( !server.listen( 5 ) ) {
-	  // maximum of 5 pending requests
-	  throw( runtime_error( "listen(5) failed" ) );
-	}
-	while ( StillRunning ) {
-	  Sockets::ServerSocket conn;
-	  if ( server.accept( conn ) ){
-	    LOG << "New connection..." << endl;
-	    int pid = fork();
-	    if (pid < 0) {
-	      string err = strerror(errno);
-	      LOG << "ERROR on fork: " << err << endl;
-	      throw runtime_error( "FORK failed: " + err );
-	    }
-	    else if (pid == 0)  {
-	      frog.FrogServer( conn );
-	      return EXIT_SUCCESS;
-	    }
-	  }
-	  else {
-	    throw( runtime_error( "Accept failed" ) );
-	  }
+	if ( !server.listen( 128 ) ) {
+	  // maximum of 128 pending connections
+	  throw( runtime_error( "listen(128) failed" ) );
 	}
+	frog.runServer( server, StillRunning, ReloadModels );
       }
       catch ( std::exception& e ) {
 	LOG << "Server error:" << e.what() << " Exiting." << endl;
@@ -39,6 +39,11 @@
 #include <sstream>
 #include <fstream>
 #include <vector>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <chrono>
 #include "config.h"
 #ifdef HAVE_OPENMP
 #include <omp.h>
@@ -75,6 +80,8 @@
 #include "frog/iob_tagger_mod.h"
 #include "frog/ner_tagger_mod.h"
 #include "frog/Parser.h"
+#include "frog/pipeline.h"
+#include "frog/column_formatter.h"
 
 
 using namespace std;
@@ -107,19 +114,24 @@ FrogOptions::FrogOptions() {
   doQuoteDetection = false;
   doDirTest = false;
   doServer = false;
+  doFramed = false;
+  doStreaming = false;
+  batchWindow = 0;
+  requestDeadline = 0;
+  maxQueue = 0;
   doXMLin =  false;
   doXMLout =  false;
   doKanon =  false;
   interactive = false;
 
   maxParserTokens = 500; // 500 words in a sentence is already insane
-  // needs about 16 Gb memory to parse!
   // set tot 0 for unlimited
 #ifdef HAVE_OPENMP
   numThreads = min<int>( 8, omp_get_max_threads() ); // ok, don't overdo
 #else
   numThreads = 1;
 #endif
+  numWorkers = 1;
   uttmark = "<utt>";
   listenport = "void";
   docid = "untitled";
@@ -141,7 +153,13 @@ FrogAPI::FrogAPI( FrogOptions &opt,
   myPoSTagger(0),
   myIOBTagger(0),
   myNERTagger(0),
-  tokenizer(0)
+  tokenizer(0),
+  formatter(0),
+  doPipeline(false),
+  pipeQueueSize(64),
+  stageThreads(NUM_STAGES,1),
+  serverPool(0),
+  metrics(0)
 {
   // for some modules init can take a long time
   // so first make sure it will not fail on some trivialities
@@ -179,207 +197,335 @@ FrogAPI::FrogAPI( FrogOptions &opt,
     options.doParse = false;
   }
 
-  if ( options.doServer ){
-    // we use fork(). omp (GCC version) doesn't do well when omp is used
-    // before the fork!
-    // see: http://bisqwit.iki.fi/story/howto/openmp/#OpenmpAndFork
-    tokenizer = new UctoTokenizer(theErrLog);
-    bool stat = tokenizer->init( configuration );
-    if ( stat ){
-      tokenizer->setPassThru( !options.doTok );
-      tokenizer->setDocID( options.docid );
-      tokenizer->setSentencePerLineInput( options.doSentencePerLine );
-      tokenizer->setQuoteDetection( options.doQuoteDetection );
-      tokenizer->setInputEncoding( options.encoding );
-      tokenizer->setInputXml( options.doXMLin );
-      tokenizer->setUttMarker( options.uttmark );
-      tokenizer->setInputClass( options.inputclass );
-      tokenizer->setOutputClass( options.outputclass );
-      myPoSTagger = new CGNTagger(theErrLog);
-      stat = myPoSTagger->init( configuration );
-      if ( stat ){
-	myPoSTagger->set_eos_mark( options.uttmark );
-	if ( options.doIOB ){
-	  myIOBTagger = new IOBTagger(theErrLog);
-	  stat = myIOBTagger->init( configuration );
-	  if ( stat ){
-	    myIOBTagger->set_eos_mark( options.uttmark );
-	  }
-	}
-	if ( stat && options.doNER ){
-	  myNERTagger = new NERTagger(theErrLog);
-	  stat = myNERTagger->init( configuration );
-	  if ( stat ){
-	    myNERTagger->set_eos_mark( options.uttmark );
-	  }
-	}
-	if ( stat && options.doLemma ){
-	  myMblem = new Mblem(theErrLog);
-	  stat = myMblem->init( configuration );
-	}
-	if ( stat && options.doMorph ){
-	  myMbma = new Mbma(theErrLog);
-	  stat = myMbma->init( configuration );
-	  if ( stat ) {
-	    if ( options.doDeepMorph )
-	      myMbma->setDeepMorph(true);
-	  }
-	}
-	if ( stat && options.doMwu ){
-	  myMwu = new Mwu(theErrLog);
-	  stat = myMwu->init( configuration );
-	  if ( stat && options.doParse ){
-	    myParser = new Parser(theErrLog);
-	    stat = myParser->init( configuration );
-	  }
-	}
-      }
-    }
-    if ( !stat ){
-      LOG << "Frog initialization failed." << endl;
-      throw runtime_error( "Frog initialization failed" );
-    }
-  }
-  else {
 #ifdef HAVE_OPENMP
-    omp_set_num_threads( options.numThreads );
-    int curt = omp_get_max_threads();
-    if ( curt != options.numThreads ){
-      LOG << "attempt to set to " << options.numThreads
-		      << " threads FAILED, running on " << curt
-		      << " threads instead" << endl;
-    }
-    else if ( options.debugFlag ){
-      LOG << "running on " << curt
-		      << " threads" << endl;
-    }
+  omp_set_num_threads( options.numThreads );
+  int curt = omp_get_max_threads();
+  if ( curt != options.numThreads ){
+    LOG << "attempt to set to " << options.numThreads
+		    << " threads FAILED, running on " << curt
+		    << " threads instead" << endl;
+  }
+  else if ( options.debugFlag ){
+    LOG << "running on " << curt
+		    << " threads" << endl;
+  }
 
 #endif
 
-    bool tokStat = true;
-    bool lemStat = true;
-    bool mwuStat = true;
-    bool mbaStat = true;
-    bool parStat = true;
-    bool tagStat = true;
-    bool iobStat = true;
-    bool nerStat = true;
+  bool tokStat = true;
+  bool lemStat = true;
+  bool mwuStat = true;
+  bool mbaStat = true;
+  bool parStat = true;
+  bool tagStat = true;
+  bool iobStat = true;
+  bool nerStat = true;
 
 #pragma omp parallel sections
-    {
+  {
 #pragma omp section
-      {
-	tokenizer = new UctoTokenizer(theErrLog);
-	tokStat = tokenizer->init( configuration );
-	if ( tokStat ){
-	  tokenizer->setPassThru( !options.doTok );
-	  tokenizer->setDocID( options.docid );
-	  tokenizer->setSentencePerLineInput( options.doSentencePerLine );
-	  tokenizer->setQuoteDetection( options.doQuoteDetection );
-	  tokenizer->setInputEncoding( options.encoding );
-	  tokenizer->setInputXml( options.doXMLin );
-	  tokenizer->setUttMarker( options.uttmark );
-	  tokenizer->setInputClass( options.inputclass );
-	  tokenizer->setOutputClass( options.outputclass );
-	}
-      }
+    {
+      tokenizer = initTokenizer();
+      tokStat = ( tokenizer != 0 );
+    }
 #pragma omp section
-      {
-	if ( options.doLemma ){
-	  myMblem = new Mblem(theErrLog);
-	  lemStat = myMblem->init( configuration );
-	}
+    {
+      if ( options.doLemma ){
+	myMblem = new Mblem(theErrLog);
+	lemStat = myMblem->init( configuration );
       }
+    }
 #pragma omp section
-      {
-	if ( options.doMorph ){
-	  myMbma = new Mbma(theErrLog);
-	  mbaStat = myMbma->init( configuration );
-	  if ( options.doDeepMorph )
-	    myMbma->setDeepMorph(true);
-	}
+    {
+      if ( options.doMorph ){
+	myMbma = new Mbma(theErrLog);
+	mbaStat = myMbma->init( configuration );
+	if ( options.doDeepMorph )
+	  myMbma->setDeepMorph(true);
       }
+    }
 #pragma omp section
-      {
-	myPoSTagger = new CGNTagger(theErrLog);
-	tagStat = myPoSTagger->init( configuration );
-      }
+    {
+      myPoSTagger = new CGNTagger(theErrLog);
+      tagStat = myPoSTagger->init( configuration );
+    }
 #pragma omp section
-      {
-	if ( options.doIOB ){
-	  myIOBTagger = new IOBTagger(theErrLog);
-	  iobStat = myIOBTagger->init( configuration );
-	}
+    {
+      if ( options.doIOB ){
+	myIOBTagger = new IOBTagger(theErrLog);
+	iobStat = myIOBTagger->init( configuration );
       }
+    }
 #pragma omp section
-      {
-	if ( options.doNER ){
-	  myNERTagger = new NERTagger(theErrLog);
-	  nerStat = myNERTagger->init( configuration );
-	}
+    {
+      if ( options.doNER ){
+	myNERTagger = new NERTagger(theErrLog);
+	nerStat = myNERTagger->init( configuration );
       }
+    }
 #pragma omp section
-      {
-	if ( options.doMwu ){
-	  myMwu = new Mwu(theErrLog);
-	  mwuStat = myMwu->init( configuration );
-	  if ( mwuStat && options.doParse ){
-	    Timer initTimer;
-	    initTimer.start();
-	    myParser = new Parser(theErrLog);
-	    parStat = myParser->init( configuration );
-	    initTimer.stop();
-	    LOG << "init Parse took: " << initTimer << endl;
-	  }
+    {
+      if ( options.doMwu ){
+	myMwu = new Mwu(theErrLog);
+	mwuStat = myMwu->init( configuration );
+	if ( mwuStat && options.doParse ){
+	  Timer initTimer;
+	  initTimer.start();
+	  myParser = new Parser(theErrLog);
+	  parStat = myParser->init( configuration );
+	  initTimer.stop();
+	  LOG << "init Parse took: " << initTimer << endl;
 	}
       }
-    }   // end omp parallel sections
-    if ( ! ( tokStat && iobStat && nerStat && tagStat && lemStat
-	     && mbaStat && mwuStat && parStat ) ){
-      string out = "Initialization failed for: ";
-      if ( !tokStat ){
-	out += "[tokenizer] ";
-      }
-      if ( !tagStat ){
-	out += "[tagger] ";
-      }
-      if ( !iobStat ){
-	out += "[IOB] ";
-      }
-      if ( !nerStat ){
-	out += "[NER] ";
-      }
-      if ( !lemStat ){
-	out += "[lemmatizer] ";
+    }
+  }   // end omp parallel sections
+  if ( ! ( tokStat && iobStat && nerStat && tagStat && lemStat
+	   && mbaStat && mwuStat && parStat ) ){
+    string out = "Initialization failed for: ";
+    if ( !tokStat ){
+      out += "[tokenizer] ";
+    }
+    if ( !tagStat ){
+      out += "[tagger] ";
+    }
+    if ( !iobStat ){
+      out += "[IOB] ";
+    }
+    if ( !nerStat ){
+      out += "[NER] ";
+    }
+    if ( !lemStat ){
+      out += "[lemmatizer] ";
+    }
+    if ( !mbaStat ){
+      out += "[morphology] ";
+    }
+    if ( !mwuStat ){
+      out += "[multiword unit] ";
+    }
+    if ( !parStat ){
+      out += "[parser] ";
+    }
+    LOG << out << endl;
+    throw runtime_error( "Frog init failed" );
+  }
+  if ( configuration.hasSection( "pipeline" ) ){
+    if ( options.doServer ){
+      LOG << "[[pipeline]] section in config file ignored in server mode"
+	  << endl;
+    }
+    else if ( !initPipeline() ){
+      throw runtime_error( "Frog init failed" );
+    }
+  }
+  FrogWorker *primary = new FrogWorker();
+  primary->myTokenizer = tokenizer;
+  initContexts( *primary );
+  primary->myParser = myParser;
+  primary->myPoSTagger = myPoSTagger;
+  primary->myIOBTagger = myIOBTagger;
+  primary->myNERTagger = myNERTagger;
+  workers.push_back( primary );
+  if ( options.numWorkers > 1 ){
+    // every extra worker loads its own copy of the taggers, and shares
+    // the rest. See initWorker()
+    LOG << "initiating " << options.numWorkers-1 << " extra workers..." << endl;
+    size_t extra = options.numWorkers - 1;
+    vector<FrogWorker*> new_workers( extra );
+    vector<int> stats( extra, 0 );
+#pragma omp parallel for schedule(dynamic)
+    for ( size_t i=0; i < extra; ++i ){
+      new_workers[i] = new FrogWorker();
+      stats[i] = initWorker( *new_workers[i] );
+    }
+    workers.insert( workers.end(), new_workers.begin(), new_workers.end() );
+    for ( const auto& stat : stats ){
+      if ( !stat ){
+	LOG << "Initialization of the extra workers failed." << endl;
+	throw runtime_error( "Frog init failed" );
       }
-      if ( !mbaStat ){
-	out += "[morphology] ";
+    }
+  }
+  formatter = new ColumnFormatter( options, configuration, theErrLog );
+  formatter->pos_tagset = myPoSTagger->getTagset();
+  if ( myMblem ){
+    formatter->lemma_tagset = myMblem->getTagset();
+  }
+  if ( myMwu ){
+    formatter->mwu_tagset = myMwu->getTagset();
+  }
+  if ( myIOBTagger ){
+    formatter->iob_tagset = myIOBTagger->getTagset();
+  }
+  if ( myNERTagger ){
+    formatter->ner_tagset = myNERTagger->getTagset();
+  }
+  if ( myParser ){
+    formatter->dep_tagset = myParser->getTagset();
+  }
+  LOG << "Initialization done." << endl;
+}
+
+UctoTokenizer *FrogAPI::initTokenizer() const {
+  UctoTokenizer *tok = new UctoTokenizer(theErrLog);
+  if ( !tok->init( configuration ) ){
+    delete tok;
+    return 0;
+  }
+  tok->setPassThru( !options.doTok );
+  tok->setDocID( options.docid );
+  tok->setSentencePerLineInput( options.doSentencePerLine );
+  tok->setQuoteDetection( options.doQuoteDetection );
+  tok->setInputEncoding( options.encoding );
+  tok->setInputXml( options.doXMLin );
+  tok->setUttMarker( options.uttmark );
+  tok->setInputClass( options.inputclass );
+  tok->setOutputClass( options.outputclass );
+  return tok;
+}
+
+static const char *stage_names[NUM_STAGES] = { "tagger", "IOB", "NER",
+						"mblem", "mbma", "mwu",
+						"parser" };
+
+bool FrogAPI::initPipeline(){
+  // a [[pipeline]] section in the config switches plain text processing
+  // to a pipeline of stages. It may set:
+  //   queueSize=<n>  the room in the queues between the stages
+  //   <module>=<n>   the number of threads for the stage of that module
+  //                  (tagger, IOB, NER, mblem, mbma, mwu or parser)
+  // every stage thread needs its own modules, so we might need extra workers
+  doPipeline = true;
+  string val = configuration.lookUp( "queueSize", "pipeline" );
+  if ( !val.empty() ){
+    if ( !stringTo( val, pipeQueueSize ) || pipeQueueSize == 0 ){
+      LOG << "invalid queueSize value in [[pipeline]] section of config file"
+	  << endl;
+      return false;
+    }
+  }
+  bool active[NUM_STAGES] = { true, options.doIOB, options.doNER,
+			      options.doLemma, options.doMorph,
+			      options.doMwu, options.doParse };
+  for ( int i=0; i < NUM_STAGES; ++i ){
+    val = configuration.lookUp( stage_names[i], "pipeline" );
+    if ( !val.empty() ){
+      if ( !stringTo( val, stageThreads[i] ) || stageThreads[i] < 1 ){
+	LOG << "invalid " << stage_names[i]
+	    << " value in [[pipeline]] section of config file" << endl;
+	return false;
       }
-      if ( !mwuStat ){
-	out += "[multiword unit] ";
+    }
+    if ( active[i] && stageThreads[i] > options.numWorkers ){
+      options.numWorkers = stageThreads[i];
+    }
+  }
+  return true;
+}
+
+bool FrogAPI::initWorker( FrogWorker& w ){
+  // Mbt offers no way to share the trees of a tagger, and tagging isn't
+  // reentrant, so every worker loads the taggers again. Everything else
+  // is shared with our own modules
+  w.myPoSTagger = new CGNTagger(theErrLog);
+  bool stat = w.myPoSTagger->init( configuration );
+  if ( stat && options.doIOB ){
+    w.myIOBTagger = new IOBTagger(theErrLog);
+    stat = w.myIOBTagger->init( configuration );
+  }
+  if ( stat && options.doNER ){
+    w.myNERTagger = new NERTagger(theErrLog);
+    stat = w.myNERTagger->init( configuration );
+  }
+  if ( stat ){
+    initContexts( w );
+  }
+  if ( stat && options.doParse ){
+    // the parser of the worker shares the Timbl trees of ours
+    w.myParser = new Parser(theErrLog);
+#pragma omp critical(context_init)
+    stat = w.myParser->init( *myParser );
+  }
+  return stat;
+}
+
+void FrogAPI::initContexts( FrogWorker& w ){
+  // Mbma and Mblem split the words of a sentence over the threads, and
+  // every thread needs a context of its own.
+  // The contexts share the Timbl trees of the modules, so take turns
+#pragma omp critical(context_init)
+  {
+    for ( int i=0; i < options.numThreads; ++i ){
+      if ( myMblem ){
+	w.mblemContexts.push_back( new MblemContext( *myMblem ) );
       }
-      if ( !parStat ){
-	out += "[parser] ";
+      if ( myMbma ){
+	w.mbmaContexts.push_back( new MbmaContext( *myMbma ) );
       }
-      LOG << out << endl;
-      throw runtime_error( "Frog init failed" );
     }
   }
-  LOG << "Initialization done." << endl;
 }
 
-FrogAPI::~FrogAPI() {
-  delete myMbma;
-  delete myMblem;
-  delete myMwu;
+void FrogWorker::setDeadline( const chrono::steady_clock::time_point& d ){
+  deadline = d;
+  hasDeadline = true;
+  skippedParses.clear();
+  skippedMorphs.clear();
+}
+
+void FrogWorker::clearDeadline(){
+  hasDeadline = false;
+  skippedParses.clear();
+  skippedMorphs.clear();
+}
+
+FrogWorker::~FrogWorker(){
+  delete myTokenizer;
+  for ( const auto& ctx : mbmaContexts ){
+    delete ctx;
+  }
+  for ( const auto& ctx : mblemContexts ){
+    delete ctx;
+  }
   delete myPoSTagger;
   delete myIOBTagger;
   delete myNERTagger;
   delete myParser;
-  delete tokenizer;
 }
 
-bool FrogAPI::TestSentence( Sentence* sent, TimerBlock& timers){
+FrogAPI::~FrogAPI() {
+  stopServer();
+  releaseModels();
+}
+
+void FrogAPI::releaseModels(){
+  // free all modules. In server mode also when a reload replaced them
+  // workers[0] owns the tokenizer and the tagger and parser modules. The
+  // parsers of the other workers share its Timbl trees, so free it last
+  for ( auto it = workers.rbegin(); it != workers.rend(); ++it ){
+    delete *it;
+  }
+  workers.clear();
+  tokenizer = 0;
+  myParser = 0;
+  myPoSTagger = 0;
+  myIOBTagger = 0;
+  myNERTagger = 0;
+  delete myMbma;
+  myMbma = 0;
+  delete myMblem;
+  myMblem = 0;
+  delete myMwu;
+  myMwu = 0;
+  delete formatter;
+  formatter = 0;
+}
+
+bool FrogAPI::TestSentence( Sentence* sent, FrogWorker& w,
+			    SentenceRecords *records ){
+  // frog sent with the modules of w. When records is given, the record of
+  // the sentence is kept there for the columned output
+  TimerBlock& timers = w.timers;
   vector<Word*> swords;
   if ( options.doQuoteDetection ){
     swords = sent->wordParts();
@@ -391,32 +537,40 @@ bool FrogAPI::TestSentence( Sentence* sent, TimerBlock& timers){
   bool all_well = true;
   string exs;
   if ( !swords.empty() ) {
+    // the modules get their input from the record, not from FoLiA
+    SentenceRecord rec( swords, options.outputclass );
+    // every module collects its FoLiA updates in its own buffer. They are
+    // committed after each step, in a fixed order, so the next step can
+    // use them.
+    AnnotationBuffer tagBuf;
+    AnnotationBuffer iobBuf;
+    AnnotationBuffer nerBuf;
 #pragma omp parallel sections shared(all_well,exs,swords)
     {
 #pragma omp section
       {
 	timers.tagTimer.start();
 	try {
-	  myPoSTagger->Classify( swords );
+	  w.myPoSTagger->Classify( rec, tagBuf );
 	}
 	catch ( exception&e ){
 	  all_well = false;
 	  exs += string(e.what()) + " ";
 	}
-	timers.tagTimer.stop();
+	timers.tagTimer.stop( rec.size() );
       }
 #pragma omp section
       {
 	if ( options.doIOB ){
 	  timers.iobTimer.start();
 	  try {
-	    myIOBTagger->Classify( swords );
+	    w.myIOBTagger->Classify( rec, iobBuf );
 	  }
 	  catch ( exception&e ){
 	    all_well = false;
 	    exs += string(e.what()) + " ";
 	  }
-	  timers.iobTimer.stop();
+	  timers.iobTimer.stop( rec.size() );
 	}
       }
 #pragma omp section
@@ -424,67 +578,73 @@ bool FrogAPI::TestSentence( Sentence* sent, TimerBlock& timers){
 	if ( options.doNER ){
 	  timers.nerTimer.start();
 	  try {
-	    myNERTagger->Classify( swords );
+	    w.myNERTagger->Classify( rec, nerBuf );
 	  }
 	  catch ( exception&e ){
 	    all_well = false;
 	    exs += string(e.what()) + " ";
 	  }
-	  timers.nerTimer.stop();
+	  timers.nerTimer.stop( rec.size() );
 	}
       }
     } // parallel sections
     if ( !all_well ){
       throw runtime_error( exs );
     }
-    for ( const auto& sword : swords ) {
-#pragma omp parallel sections
-      {
-#pragma omp section
-	{
-	  if ( options.doMorph ){
-	    timers.mbmaTimer.start();
-	    if (options.debugFlag){
-	      LOG << "Calling mbma..." << endl;
-	    }
-	    try {
-	      myMbma->Classify( sword );
-	    }
-	    catch ( exception& e ){
-	      all_well = false;
-	      exs += string(e.what()) + " ";
-	    }
-	    timers.mbmaTimer.stop();
-	  }
-	}
-#pragma omp section
-	{
-	  if ( options.doLemma ){
-	    timers.mblemTimer.start();
-	    if (options.debugFlag) {
-	      LOG << "Calling mblem..." << endl;
-	    }
-	    try {
-	      myMblem->Classify( sword );
-	    }
-	    catch ( exception&e ){
-	      all_well = false;
-	      exs += string(e.what()) + " ";
-	    }
-	    timers.mblemTimer.stop();
-	  }
-	}
-      } // omp parallel sections
-    } //for int i = 0 to num_words
+    tagBuf.commit();
+    iobBuf.commit();
+    nerBuf.commit();
+    AnnotationBuffer mbmaBuf;
+    AnnotationBuffer mblemBuf;
+    // morphology and lemmatization each handle the whole sentence, with
+    // the words split over the threads
+    if ( options.doMorph ){
+      bool deep = options.doDeepMorph;
+      if ( deep && w.pastDeadline() ){
+	// deep morphology is expensive, when out of time we only give
+	// the shallow analysis
+	deep = false;
+	w.skippedMorphs.push_back( sent );
+      }
+      timers.mbmaTimer.start();
+      if (options.debugFlag){
+	LOG << "Calling mbma..." << endl;
+      }
+      try {
+	myMbma->Classify( rec, w.mbmaContexts, mbmaBuf, deep );
+      }
+      catch ( exception& e ){
+	all_well = false;
+	exs += string(e.what()) + " ";
+      }
+      timers.mbmaTimer.stop( rec.size() );
+    }
+    if ( options.doLemma ){
+      timers.mblemTimer.start();
+      if (options.debugFlag) {
+	LOG << "Calling mblem..." << endl;
+      }
+      try {
+	myMblem->Classify( rec, w.mblemContexts, mblemBuf );
+      }
+      catch ( exception&e ){
+	all_well = false;
+	exs += string(e.what()) + " ";
+      }
+      timers.mblemTimer.stop( rec.size() );
+    }
     if ( !all_well ){
       throw runtime_error( exs );
     }
-
+    mbmaBuf.commit();
+    mblemBuf.commit();
+    AnnotationBuffer buf;
     if ( options.doMwu ){
       if ( swords.size() > 0 ){
 	timers.mwuTimer.start();
-	myMwu->Classify( swords );
-	timers.mwuTimer.stop();
+	myMwu->Classify( rec, buf );
+	buf.commit();
+	timers.mwuTimer.stop( rec.size() );
       }
     }
     if ( options.doParse ){
@@ -492,103 +652,21 @@ bool FrogAPI::TestSentence( Sentence* sent, TimerBlock& timers){
 	   && swords.size() > options.maxParserTokens ){
 	showParse = false;
       }
-      else {
-        myParser->Parse( swords, timers );
-      }
-    }
-  }
-  return showParse;
-}
-
-void FrogAPI::FrogServer( Sockets::ServerSocket &conn ){
-  try {
-    while (true) {
-      ostringstream outputstream;
-      if ( options.doXMLin ){
-        string result;
-        string s;
-        while ( conn.read(s) ){
-            result += s + "\n";
-            if ( s.empty() )
-                break;
-        }
-        if ( result.size() < 50 ){
-            // a FoLia doc must be at least a few 100 bytes
-            // so this is wrong. Just bail out
-            throw( runtime_error( "read garbage" ) );
-        }
-        if ( options.debugFlag ){
-	  LOG << "received data [" << result << "]" << endl;
-	}
-        Document doc;
-        try {
-	  doc.readFromString( result );
-        }
-	catch ( std::exception& e ){
-	  LOG << "FoLiaParsing failed:" << endl << e.what() << endl;
-	  throw;
-        }
-        LOG << "Processing... " << endl;
-	timers.reset();
-	timers.tokTimer.start();
-	tokenizer->tokenize( doc );
-	timers.tokTimer.stop();
-        FrogDoc( doc );
-	if ( options.doXMLout ){
-	  doc.save( outputstream, options.doKanon );
-	}
-	else {
-	  showResults( outputstream, doc );
-	}
+      else if ( w.pastDeadline() ){
+	w.skippedParses.push_back( sent );
       }
       else {
-        string data = "";
-        if ( options.doSentencePerLine ){
-	  if ( !conn.read( data ) ){
-	    //read data from client
-	    throw( runtime_error( "read failed" ) );
-	  }
-	}
-        else {
-	  string line;
-	  while( conn.read(line) ){
-	    if ( line == "EOT" )
-	      break;
-	    data += line + "\n";
-	  }
-        }
-        if ( options.debugFlag ){
-	  LOG << "Received: [" << data << "]" << endl;
-	}
-        LOG << "Processing... " << endl;
-        istringstream inputstream(data,istringstream::in);
-	timers.reset();
-	timers.tokTimer.start();
-        Document *doc = tokenizer->tokenize( inputstream );
-	timers.tokTimer.stop();
-        FrogDoc( *doc );
-	if ( options.doXMLout ){
-	  doc->save( outputstream, options.doKanon );
-	}
-	else {
-	  showResults( outputstream, *doc );
-	}
-	delete doc;
-      }
-      if (!conn.write( (outputstream.str()) ) || !(conn.write("READY\n"))  ){
-	if (options.debugFlag) {
-	  LOG << "socket " << conn.getMessage() << endl;
-	}
-	throw( runtime_error( "write to client failed" ) );
+        w.myParser->Parse( rec, timers, buf );
+	buf.commit();
       }
     }
-  }
-  catch ( std::exception& e ) {
-    if (options.debugFlag){
-      LOG << "connection lost: " << e.what() << endl;
+    if ( records && !options.doQuoteDetection ){
+      // (with quote detection we frog sentence parts, which aren't output
+      // on their own)
+      records->add( sent, std::move( rec ) );
     }
   }
-  LOG << "Connection closed.\n";
+  return showParse;
 }
 
 void FrogAPI::FrogStdin( bool prompt ) {
@@ -635,8 +713,9 @@ void FrogAPI::FrogStdin( bool prompt ) {
     }
     istringstream inputstream(data,istringstream::in);
     Document *doc = tokenizer->tokenize( inputstream );
-    FrogDoc( *doc, true );
-    showResults( cout, *doc );
+    SentenceRecords records;
+    FrogDoc( *doc, true, &records );
+    showResults( cout, *doc, &records );
     delete doc;
     if ( prompt ){
       cout << "frog>"; cout.flush();
@@ -707,8 +786,9 @@ void FrogAPI::FrogInteractive(){
 	cout << "Processing... '" << data << "'" << endl;
 	istringstream inputstream(data,istringstream::in);
 	Document *doc = tokenizer->tokenize( inputstream );
-	FrogDoc( *doc, true );
-	showResults( cout, *doc );
+	SentenceRecords records;
+	FrogDoc( *doc, true, &records );
+	showResults( cout, *doc, &records );
 	delete doc;
       }
     }
@@ -717,188 +797,6 @@ void FrogAPI::FrogInteractive(){
 #endif
 }
 
-vector<Word*> FrogAPI::lookup( Word *word,
-			       const vector<Entity*>& entities ) const {
-  for ( const auto& ent : entities ){
-    vector<Word*> vec = ent->select<Word>();
-    if ( !vec.empty() ){
-      if ( vec[0]->id() == word->id() ) {
-	return vec;
-      }
-    }
-  }
-  vector<Word*> vec;
-  vec.push_back( word ); // single unit
-  return vec;
-}
-
-Dependency *FrogAPI::lookupDep( const Word *word,
-				const vector<Dependency*>&dependencies ) const{
-  if (dependencies.size() == 0 ){
-    return 0;
-  }
-  int dbFlag = 0;
-  try {
-    dbFlag = stringTo<int>( configuration.lookUp( "debug", "parser" ) );
-  }
-  catch (exception & e) {
-    dbFlag = 0;
-  }
-  if ( dbFlag ){
-    using TiCC::operator<<;
-    LOG << "\nDependency-lookup "<< word << " in " << dependencies << endl;
-  }
-  for ( const auto& dep : dependencies ){
-    if ( dbFlag ){
-      LOG << "Dependency try: " << dep << endl;
-    }
-    try {
-      vector<DependencyDependent*> dv = dep->select<DependencyDependent>();
-      if ( !dv.empty() ){
-	vector<Word*> wv = dv[0]->select<Word>();
-	for ( const auto& w : wv ){
-	  if ( w == word ){
-	    if ( dbFlag ){
-	      LOG << "\nDependency found word " << w << endl;
-	    }
-	    return dep;
-	  }
-	}
-      }
-    }
-    catch ( exception& e ){
-      if (dbFlag > 0){
-	LOG << "get Dependency results failed: "
-			<< e.what() << endl;
-      }
-    }
-  }
-  return 0;
-}
-
-string FrogAPI::lookupNEREntity( const vector<Word *>& mwus,
-				 const vector<Entity*>& entities ) const {
-  string endresult;
-  int dbFlag = 0;
-  try{
-    dbFlag = stringTo<int>( configuration.lookUp( "debug", "NER" ) );
-  }
-  catch (exception & e) {
-    dbFlag = 0;
-  }
-  for ( const auto& mwu : mwus ){
-    if ( dbFlag ){
-      using TiCC::operator<<;
-      LOG << "\nNER: lookup "<< mwu << " in " << entities << endl;
-    }
-    string result;
-    for ( const auto& entity :entities ){
-      if ( dbFlag ){
-	LOG << "NER: try: " << entity << endl;
-      }
-      try {
-	vector<Word*> wv = entity->select<Word>();
-	bool first = true;
-	for ( const auto& word : wv ){
-	  if ( word == mwu ){
-	    if (dbFlag){
-	      LOG << "NER found word " << word << endl;
-	    }
-	    if ( first ){
-	      result += "B-" + uppercase(entity->cls());
-	    }
-	    else {
-	      result += "I-" + uppercase(entity->cls());
-	    }
-	    break;
-	  }
-	  else {
-	    first = false;
-	  }
-	}
-      }
-      catch ( exception& e ){
-	if  (dbFlag > 0){
-	  LOG << "get NER results failed: "
-			  << e.what() << endl;
-	}
-      }
-    }
-    if ( result.empty() ){
-      endresult += "O";
-    }
-    else {
-      endresult += result;
-    }
-    if ( &mwu != &mwus.back() ){
-      endresult += "_";
-    }
-  }
-  return endresult;
-}
-
-
-string FrogAPI::lookupIOBChunk( const vector<Word *>& mwus,
-				const vector<Chunk*>& chunks ) const{
-  string endresult;
-  int dbFlag = 0;
-  try {
-   dbFlag = stringTo<int>( configuration.lookUp( "debug", "IOB" ) );
-  }
-  catch (exception & e) {
-    dbFlag = 0;
-  }
-  for ( const auto& mwu : mwus ){
-    if ( dbFlag ){
-      using TiCC::operator<<;
-      LOG << "IOB lookup "<< mwu << " in " << chunks << endl;
-    }
-    string result;
-    for ( const auto& chunk : chunks ){
-      if ( dbFlag ){
-	LOG << "IOB try: " << chunk << endl;
-      }
-      try {
-	vector<Word*> wv = chunk->select<Word>();
-	bool first = true;
-	for ( const auto& word : wv ){
-	  if ( word == mwu ){
-	    if (dbFlag){
-	      LOG << "IOB found word " << word << endl;
-	    }
-	    if ( first ) {
-	      result += "B-" + chunk->cls();
-	    }
-	    else {
-	      result += "I-" + chunk->cls();
-	    }
-	    break;
-	  }
-	  else {
-	    first = false;
-	  }
-	}
-      }
-      catch ( exception& e ){
-	if  (dbFlag > 0) {
-	  LOG << "get Chunks results failed: "
-			  << e.what() << endl;
-	}
-      }
-    }
-    if ( result.empty() ) {
-      endresult += "O";
-    }
-    else {
-      endresult += result;
-    }
-    if ( &mwu != &mwus.back() ){
-      endresult += "_";
-    }
-  }
-  return endresult;
-}
-
 vector<string> get_compound_analysis( folia::Word* word ){
   vector<string> result;
   vector<MorphologyLayer*> layers
@@ -985,215 +883,18 @@ vector<string> get_full_morph_analysis( folia::Word* w,
   return result;
 }
 
-void FrogAPI::displayMWU( ostream& os,
-			  size_t index,
-			  const vector<Word*>& mwu ) const {
-  string wrd;
-  string pos;
-  string lemma;
-  string morph;
-  string comp;
-  double conf = 1;
-  for ( const auto& word : mwu ){
-    try {
-      wrd += word->str( options.outputclass );
-      PosAnnotation *postag = word->annotation<PosAnnotation>( myPoSTagger->getTagset() );
-      pos += postag->cls();
-      if ( &word != &mwu.back() ){
-	wrd += "_";
-	pos += "_";
-      }
-      conf *= postag->confidence();
-    }
-    catch ( exception& e ){
-      if  (options.debugFlag > 0){
-	LOG << "get Postag results failed: "
-			<< e.what() << endl;
-      }
-    }
-    if ( options.doLemma ){
-      try {
-	lemma += word->lemma(myMblem->getTagset());
-	if ( &word != &mwu.back() ){
-	  lemma += "_";
-	}
-      }
-      catch ( exception& e ){
-	if  (options.debugFlag > 0){
-	  LOG << "get Lemma results failed: "
-			  << e.what() << endl;
-	}
-      }
-    }
-    if ( options.doMorph ){
-      // also covers doDeepMorph
-      try {
-	vector<string> morphs = get_full_morph_analysis( word, options.outputclass );
-	for ( const auto& m : morphs ){
-	  morph += m;
-	  if ( &m != &morphs.back() ){
-	    morph += "/";
-	  }
-	}
-	if ( &word != &mwu.back() ){
-	  morph += "_";
-	}
-      }
-      catch ( exception& e ){
-	if  (options.debugFlag > 0){
-	  LOG << "get Morph results failed: "
-			  << e.what() << endl;
-	}
-      }
-    }
-    if ( options.doDeepMorph ){
-      try {
-	vector<string> cpv = get_compound_analysis( word );
-	for ( const auto& cp : cpv ){
-	  if ( cp.empty() ){
-	    comp += "0";
-	  }
-	  else {
-	    comp += cp+"-compound";
-	  }
-	  if ( &cp != &cpv.back() ){
-	    morph += "/";
-	  }
-	}
-	if ( &word != &mwu.back() ){
-	  comp += "_";
-	}
-      }
-      catch ( exception& e ){
-	if  (options.debugFlag > 0){
-	  LOG << "get Morph results failed: "
-			  << e.what() << endl;
-	}
-      }
-    }
-  }
-  os << index << "\t" << wrd << "\t" << lemma << "\t" << morph;
-  if ( options.doDeepMorph ){
-    if ( comp.empty() ){
-      comp = "0";
-    }
-    os << "\t" << comp;
-  }
-  os << "\t" << pos << "\t" << std::fixed << conf;
-}
-
 ostream& FrogAPI::showResults( ostream& os,
-			       Document& doc ) const {
-  vector<Sentence*> sentences = doc.sentences();
-  for ( auto const& sentence : sentences ){
-    vector<Word*> words = sentence->words();
-    vector<Entity*> mwu_entities;
-    if (myMwu){
-      mwu_entities = sentence->select<Entity>( myMwu->getTagset() );
-    }
-    vector<Dependency*> dependencies;
-    if (myParser){
-      dependencies = sentence->select<Dependency>( myParser->getTagset() );
-    }
-    vector<Chunk*> iob_chunking;
-    if ( myIOBTagger ){
-      iob_chunking = sentence->select<Chunk>( myIOBTagger->getTagset() );
-    }
-    vector<Entity*> ner_entities;
-    if (myNERTagger){
-      ner_entities =  sentence->select<Entity>( myNERTagger->getTagset() );
-    }
-    static set<ElementType> excludeSet;
-    vector<Sentence*> parts = sentence->select<Sentence>( excludeSet );
-    if ( !options.doQuoteDetection ){
-      assert( parts.size() == 0 );
-    }
-    for ( auto const& part : parts ){
-      vector<Entity*> ents;
-      if (myMwu){
-	ents = part->select<Entity>( myMwu->getTagset() );
-      }
-      mwu_entities.insert( mwu_entities.end(), ents.begin(), ents.end() );
-      vector<Dependency*> deps = part->select<Dependency>();
-      dependencies.insert( dependencies.end(), deps.begin(), deps.end() );
-      vector<Chunk*> chunks = part->select<Chunk>();
-      iob_chunking.insert( iob_chunking.end(), chunks.begin(), chunks.end() );
-      vector<Entity*> ners ;
-      if (myNERTagger) {
-	ners = part->select<Entity>( myNERTagger->getTagset() );
-      }
-      ner_entities.insert( ner_entities.end(), ners.begin(), ners.end() );
-    }
-
-    size_t index = 1;
-    map<FoliaElement*, int> enumeration;
-    vector<vector<Word*> > mwus;
-    for ( size_t i=0; i < words.size(); ++i ){
-      Word *word = words[i];
-      vector<Word*> mwu = lookup( word, mwu_entities );
-      for ( size_t j=0; j < mwu.size(); ++j ){
-	enumeration[mwu[j]] = index;
-      }
-      mwus.push_back( mwu );
-      i += mwu.size()-1;
-      ++index;
-    }
-    index = 0;
-    for ( const auto& mwu : mwus ){
-      displayMWU( os, ++index, mwu );
-      if ( options.doNER ){
-	string cls;
-	string s = lookupNEREntity( mwu, ner_entities );
-	os << "\t" << s;
-      }
-      else {
-	os << "\t\t";
-      }
-      if ( options.doIOB ){
-	string cls;
-	string s = lookupIOBChunk( mwu, iob_chunking);
-	os << "\t" << s;
-      }
-      else {
-	os << "\t\t";
-      }
-      if ( options.doParse ){
-	string cls;
-	Dependency *dep = lookupDep( mwu[0], dependencies);
-	if ( dep ){
-	  vector<Headspan*> w = dep->select<Headspan>();
-	  size_t num;
-	  if ( w[0]->index(0)->isinstance( PlaceHolder_t ) ){
-	    string indexS = w[0]->index(0)->str();
-	    FoliaElement *pnt = w[0]->index(0)->doc()->index(indexS);
-	    num = enumeration.find(pnt->index(0))->second;
-	  }
-	  else {
-	    num = enumeration.find(w[0]->index(0))->second;
-	  }
-	  os << "\t" << num << "\t" << dep->cls();
-	}
-	else {
-	  os << "\t"<< 0 << "\tROOT";
-	}
-      }
-      else {
-	os << "\t\t";
-      }
-      os << endl;
-    }
-    if ( words.size() ){
-      os << endl;
-    }
-  }
-  return os;
+			       Document& doc,
+			       const SentenceRecords *records ) const {
+  return formatter->show( os, doc, records );
 }
 
 string FrogAPI::Frogtostring( const string& s ){
   Document *doc = tokenizer->tokenizestring( s );
   stringstream ss;
-  FrogDoc( *doc, true );
-  showResults( ss, *doc );
+  SentenceRecords records;
+  FrogDoc( *doc, true, &records );
+  showResults( ss, *doc, &records );
   delete doc;
   return ss.str();
 }
@@ -1204,10 +905,55 @@ string FrogAPI::Frogtostringfromfile( const string& name ){
   return ss.str();
 }
 
-void FrogAPI::FrogDoc( Document& doc,
-		       bool hidetimers ){
-  timers.frogTimer.start();
-  // first we make sure that the doc will accept our annotations, by
+void FrogAPI::resetTimers(){
+  timers.reset();
+  for ( const auto& w : workers ){
+    w->timers.reset();
+  }
+}
+
+void FrogAPI::showTimers() const {
+  // the module timings of all workers together
+  TimerBlock total;
+  for ( const auto& w : workers ){
+    total.add( w->timers );
+  }
+  showTimers( timers, total );
+}
+
+void FrogAPI::showTimers( const TimerBlock& ftimers,
+			  const TimerBlock& wtimers ) const {
+  // ftimers holds the tokenizer and total times, wtimers the modules
+  LOG << "tokenisation took:  " << ftimers.tokTimer << endl;
+  LOG << "CGN tagging took:   " << wtimers.tagTimer << endl;
+  if ( options.doIOB){
+    LOG << "IOB chunking took:  " << wtimers.iobTimer << endl;
+  }
+  if ( options.doNER){
+    LOG << "NER took:           " << wtimers.nerTimer << endl;
+  }
+  if ( options.doMorph ){
+    LOG << "MBMA took:          " << wtimers.mbmaTimer << endl;
+  }
+  if ( options.doLemma ){
+    LOG << "Mblem took:         " << wtimers.mblemTimer << endl;
+  }
+  if ( options.doMwu ){
+    LOG << "MWU resolving took: " << wtimers.mwuTimer << endl;
+  }
+  if ( options.doParse ){
+    LOG << "Parsing (prepare) took: " << wtimers.prepareTimer << endl;
+    LOG << "Parsing (pairs)   took: " << wtimers.pairsTimer << endl;
+    LOG << "Parsing (rels)    took: " << wtimers.relsTimer << endl;
+    LOG << "Parsing (dir)     took: " << wtimers.dirTimer << endl;
+    LOG << "Parsing (csi)     took: " << wtimers.csiTimer << endl;
+    LOG << "Parsing (total)   took: " << wtimers.parseTimer << endl;
+  }
+  LOG << "Frogging in total took: " << ftimers.frogTimer << endl;
+}
+
+void FrogAPI::addDeclarations( Document& doc ) const {
+  // make sure that the doc will accept our annotations, by
   // declaring them in the doc
   if (myPoSTagger){
     myPoSTagger->addDeclaration( doc );
@@ -1230,6 +976,19 @@ void FrogAPI::FrogDoc( Document& doc,
   if ( options.doParse && myParser ){
     myParser->addDeclaration( doc );
   }
+}
+
+void FrogAPI::TestDocument( Document& doc,
+			    FrogWorker *fw,
+			    const function<void(Sentence*)>& done,
+			    SentenceRecords *records ){
+  // frog all sentences of doc. When fw is given, only that worker is used.
+  // Otherwise the sentences are spread over all workers.
+  // When records is given, the records of the sentences are kept there.
+  // When given, done is called for every sentence of doc, in order. With
+  // one worker right after the sentence is frogged, otherwise (and with
+  // quote detection, where we frog sentence parts) at the end.
+  addDeclarations( doc );
   if ( options.debugFlag > 5 ){
     LOG << "Testing document :" << doc << endl;
   }
@@ -1247,26 +1006,17 @@ void FrogAPI::FrogDoc( Document& doc,
       LOG << "found " << numS
 		      << " sentence(s) in document." << endl;
     }
-    for ( size_t i = 0; i < numS; ++i ) {
-      //NOTE- full sentences are passed (which may span multiple lines) (MvG)
-      string lan = sentences[i]->language();
-      if ( !options.language.empty()
-	   && options.language != "none"
-	   && !lan.empty()
-	   && lan != options.language ){
-	if  (options.debugFlag >= 0){
-	  LOG << "Not processing sentence " << i+1 << endl
-			  << " different language: " << lan << endl
-			  << " --language=" << options.language << endl;
+    bool stream = done && ( fw || workers.size() == 1 )
+      && !options.doQuoteDetection;
+    if ( stream ){
+      TestSentences( sentences, fw, done, records );
+    }
+    else {
+      TestSentences( sentences, fw, nullptr, records );
+      if ( done ){
+	for ( const auto& sent : doc.sentences() ){
+	  done( sent );
 	}
-	continue;
-      }
-      bool showParse = TestSentence( sentences[i], timers );
-      if ( options.doParse && !showParse ){
-	LOG << "WARNING!" << endl;
-	LOG << "Sentence " << i+1
-			<< " isn't parsed because it contains more tokens then set with the --max-parser-tokens="
-			<< options.maxParserTokens << " option." << endl;
       }
     }
   }
@@ -1276,45 +1026,446 @@ void FrogAPI::FrogDoc( Document& doc,
     }
   }
 
+}
+
+void FrogAPI::TestSentences( const vector<Sentence*>& sentences,
+			     FrogWorker *fw,
+			     const function<void(Sentence*)>& done,
+			     SentenceRecords *records ){
+  // frog the sentences, which may come from several documents.
+  // When fw is given, only that worker is used. Otherwise the sentences are
+  // spread over all workers.
+  // done is called right after a sentence is frogged. Only in order when
+  // there is just one worker.
+  size_t numS = sentences.size();
+  // sentences are independent, so with more then 1 worker we frog them
+  // in parallel. Every thread uses its own set of modules.
+  int numW = fw ? 1 : workers.size();
+  vector<int> parsed( numS, 1 );
+  bool all_well = true;
+  string exs;
+#pragma omp parallel for schedule(dynamic) num_threads(numW) if(numW > 1)
+  for ( size_t i = 0; i < numS; ++i ) {
+    if ( !all_well ){
+      continue;
+    }
+    //NOTE- full sentences are passed (which may span multiple lines) (MvG)
+    string lan = sentences[i]->language();
+    if ( !options.language.empty()
+	 && options.language != "none"
+	 && !lan.empty()
+	 && lan != options.language ){
+      if  (options.debugFlag >= 0){
+	LOG << "Not processing sentence " << i+1 << endl
+			<< " different language: " << lan << endl
+			<< " --language=" << options.language << endl;
+      }
+      if ( done ){
+	done( sentences[i] );
+      }
+      continue;
+    }
+    FrogWorker *w = fw;
+    if ( !w ){
+#ifdef HAVE_OPENMP
+      w = workers[omp_get_thread_num()];
+#else
+      w = workers[0];
+#endif
+    }
+    try {
+      parsed[i] = TestSentence( sentences[i], *w, records );
+      if ( done ){
+	done( sentences[i] );
+      }
+    }
+    catch ( exception& e ){
+#pragma omp critical(frog_errors)
+      {
+	all_well = false;
+	exs += string(e.what()) + " ";
+      }
+    }
+  }
+  if ( !all_well ){
+    throw runtime_error( exs );
+  }
+  if ( options.doParse ){
+    for ( size_t i = 0; i < numS; ++i ) {
+      if ( !parsed[i] ){
+	LOG << "WARNING!" << endl;
+	LOG << "Sentence " << i+1
+			<< " isn't parsed because it contains more tokens then set with the --max-parser-tokens="
+			<< options.maxParserTokens << " option." << endl;
+      }
+    }
+  }
+}
+
+void FrogAPI::FrogDoc( Document& doc,
+		       bool hidetimers,
+		       SentenceRecords *records ){
+  timers.frogTimer.start();
+  TestDocument( doc, 0, nullptr, records );
   timers.frogTimer.stop();
   if ( !hidetimers ){
-    LOG << "tokenisation took:  " << timers.tokTimer << endl;
-    LOG << "CGN tagging took:   " << timers.tagTimer << endl;
-    if ( options.doIOB){
-      LOG << "IOB chunking took:  " << timers.iobTimer << endl;
+    showTimers();
+  }
+  return;
+}
+
+const size_t stream_chunk_lines = 1000;
+
+static bool is_empty_line( const string& line ){
+  return line.find_first_not_of( " \t\r\n" ) == string::npos;
+}
+
+static bool ends_sentence( const string& line ){
+  string::size_type pos = line.find_last_not_of( " \t\r" );
+  if ( pos == string::npos ){
+    return false;
+  }
+  char c = line[pos];
+  return c == '.' || c == '!' || c == '?';
+}
+
+static bool read_chunk( istream& is, string& chunk, bool sentence_per_line ){
+  // read the next chunk of plain text input: whole paragraphs, until
+  // we have at least stream_chunk_lines lines. For text without empty lines,
+  // we split after a line that ends a sentence, and as a last resort anywhere.
+  chunk.clear();
+  size_t lines = 0;
+  string line;
+  while ( getline( is, line ) ){
+    chunk += line + "\n";
+    if ( ++lines >= stream_chunk_lines
+	 && ( sentence_per_line
+	      || is_empty_line( line )
+	      || ( lines >= 10*stream_chunk_lines && ends_sentence( line ) )
+	      || lines >= 100*stream_chunk_lines ) ){
+      break;
     }
-    if ( options.doNER){
-      LOG << "NER took:           " << timers.nerTimer << endl;
+  }
+  return lines > 0;
+}
+
+void FrogAPI::FrogStream( istream& is, ostream& os, FrogWorker *fw ){
+  // Frog plain text chunk by chunk, and free every chunk as soon as its
+  // results are written. So output appears right away, and memory use
+  // doesn't depend on the size of the input.
+  // When fw is given, only that worker (and its tokenizer) is used.
+  string chunk;
+  while ( read_chunk( is, chunk, options.doSentencePerLine ) ){
+    if ( is_empty_line( chunk ) ){
+      continue;
     }
-    if ( options.doMorph ){
-      LOG << "MBMA took:          " << timers.mbmaTimer << endl;
+    if ( fw ){
+      fw->timers.tokTimer.start();
+      Document *doc = fw->myTokenizer->tokenizestring( chunk );
+      fw->timers.tokTimer.stop();
+      SentenceRecords records;
+      TestDocument( *doc, fw, nullptr, &records );
+      showResults( os, *doc, &records );
+      delete doc;
+      continue;
     }
-    if ( options.doLemma ){
-      LOG << "Mblem took:         " << timers.mblemTimer << endl;
+    timers.tokTimer.start();
+    Document *doc = tokenizer->tokenizestring( chunk );
+    timers.tokTimer.stop();
+    SentenceRecords records;
+    FrogDoc( *doc, true, &records );
+    showResults( os, *doc, &records );
+    os.flush();
+    delete doc;
+  }
+}
+
+struct DocRecord {
+  // a tokenized chunk of input on its way through the pipeline
+  Document *doc;
+  size_t seq;     // position in the input
+  size_t size;    // number of sentences
+  size_t done;    // number of sentences that reached the writer
+  vector<size_t> unparsed;
+  SentenceRecords records; // of the sentences that reached the writer
+};
+
+struct PipeItem {
+  // one sentence on its way through the pipeline
+  DocRecord *rec;
+  Sentence *sent;
+  vector<Word*> words;
+  SentenceRecord record;
+  size_t index;  // position in the doc
+  bool skip;
+  bool parsed;
+};
+
+void FrogAPI::runStage( int stage, FrogWorker& w, PipeItem& item ){
+  if ( item.words.empty() ){
+    return;
+  }
+  SentenceRecord& rec = item.record;
+  TimerBlock& timers = w.timers;
+  // a stage only reads the sentence, and commits its own annotations at
+  // the end. The next stage gets the item after that.
+  AnnotationBuffer buf;
+  switch ( stage ){
+  case TAG_STAGE:
+    // the first stage, fill the record
+    rec.fill( item.words, options.outputclass );
+    timers.tagTimer.start();
+    w.myPoSTagger->Classify( rec, buf );
+    timers.tagTimer.stop( rec.size() );
+    break;
+  case IOB_STAGE:
+    timers.iobTimer.start();
+    w.myIOBTagger->Classify( rec, buf );
+    timers.iobTimer.stop( rec.size() );
+    break;
+  case NER_STAGE:
+    timers.nerTimer.start();
+    w.myNERTagger->Classify( rec, buf );
+    timers.nerTimer.stop( rec.size() );
+    break;
+  case LEMMA_STAGE:
+    timers.mblemTimer.start();
+    myMblem->Classify( rec, *w.mblemContexts.front(), buf );
+    timers.mblemTimer.stop( rec.size() );
+    break;
+  case MORPH_STAGE:
+    timers.mbmaTimer.start();
+    myMbma->Classify( rec, *w.mbmaContexts.front(), buf );
+    timers.mbmaTimer.stop( rec.size() );
+    break;
+  case MWU_STAGE:
+    timers.mwuTimer.start();
+    myMwu->Classify( rec, buf );
+    timers.mwuTimer.stop( rec.size() );
+    break;
+  case PARSE_STAGE:
+    if ( options.maxParserTokens != 0
+	 && item.words.size() > options.maxParserTokens ){
+      item.parsed = false;
     }
-    if ( options.doMwu ){
-      LOG << "MWU resolving took: " << timers.mwuTimer << endl;
+    else {
+      w.myParser->Parse( rec, timers, buf );
     }
-    if ( options.doParse ){
-      LOG << "Parsing (prepare) took: " << timers.prepareTimer << endl;
-      LOG << "Parsing (pairs)   took: " << timers.pairsTimer << endl;
-      LOG << "Parsing (rels)    took: " << timers.relsTimer << endl;
-      LOG << "Parsing (dir)     took: " << timers.dirTimer << endl;
-      LOG << "Parsing (csi)     took: " << timers.csiTimer << endl;
-      LOG << "Parsing (total)   took: " << timers.parseTimer << endl;
+    break;
+  default:
+    throw logic_error( "unknown pipeline stage" );
+  }
+  buf.commit();
+}
+
+void FrogAPI::FrogPipeline( istream& is, ostream& os ){
+  // Frog plain text in a pipeline. Every module is a stage, with one or
+  // more threads of its own, and bounded queues between the stages.
+  // So sentence N can be parsed while sentence N+1 is tagged and N+2 is
+  // tokenized. Thread t of a stage uses the modules of workers[t].
+  // The tokenizer runs in this thread, the writer in a thread of its own.
+  // The writer outputs the chunks in input order.
+  vector<int> stages;
+  stages.push_back( TAG_STAGE );
+  if ( options.doIOB ){
+    stages.push_back( IOB_STAGE );
+  }
+  if ( options.doNER ){
+    stages.push_back( NER_STAGE );
+  }
+  if ( options.doLemma ){
+    stages.push_back( LEMMA_STAGE );
+  }
+  if ( options.doMorph ){
+    stages.push_back( MORPH_STAGE );
+  }
+  if ( options.doMwu ){
+    stages.push_back( MWU_STAGE );
+  }
+  if ( options.doParse ){
+    stages.push_back( PARSE_STAGE );
+  }
+  // queues[i] feeds stage i, the last one feeds the writer
+  // producers[i] counts the threads that still might push to queues[i]
+  size_t numQ = stages.size() + 1;
+  vector<BoundedQueue<PipeItem*>*> queues( numQ );
+  vector<atomic<int>> producers( numQ );
+  for ( size_t i=0; i < numQ; ++i ){
+    queues[i] = new BoundedQueue<PipeItem*>( pipeQueueSize );
+    producers[i].store( i == 0 ? 1 : stageThreads[stages[i-1]] );
+  }
+  atomic<bool> failed( false );
+  mutex error_mutex;
+  string exs;
+  timers.frogTimer.start();
+  vector<thread> threads;
+  for ( size_t i=0; i < stages.size(); ++i ){
+    for ( int t=0; t < stageThreads[stages[i]]; ++t ){
+      threads.push_back( thread( [&,i,t](){
+	    FrogWorker& w = *workers[t];
+	    unsigned int spins = 0;
+	    while ( true ){
+	      bool done = ( producers[i].load() == 0 );
+	      PipeItem *item;
+	      if ( queues[i]->try_pop( item ) ){
+		spins = 0;
+		if ( !item->skip && !failed.load() ){
+		  try {
+		    runStage( stages[i], w, *item );
+		  }
+		  catch ( exception& e ){
+		    lock_guard<mutex> lock( error_mutex );
+		    exs += string(e.what()) + " ";
+		    failed.store( true );
+		  }
+		}
+		queues[i+1]->push( item );
+	      }
+	      else if ( done ){
+		break;
+	      }
+	      else {
+		pipe_backoff( spins );
+	      }
+	    }
+	    --producers[i+1];
+	  } ) );
     }
-   LOG << "Frogging in total took: " << timers.frogTimer << endl;
   }
-  return;
+  threads.push_back( thread( [&](){
+	// the writer. Collect the sentences of every chunk, and output the
+	// chunks in order, when they are complete.
+	map<size_t,DocRecord*> complete;
+	size_t next = 0;
+	unsigned int spins = 0;
+	while ( true ){
+	  bool done = ( producers[numQ-1].load() == 0 );
+	  PipeItem *item;
+	  if ( queues[numQ-1]->try_pop( item ) ){
+	    spins = 0;
+	    DocRecord *rec = item->rec;
+	    if ( !item->parsed ){
+	      rec->unparsed.push_back( item->index );
+	    }
+	    if ( !item->words.empty() && !options.doQuoteDetection ){
+	      rec->records.add( item->sent, std::move( item->record ) );
+	    }
+	    delete item;
+	    if ( ++rec->done == rec->size ){
+	      complete[rec->seq] = rec;
+	    }
+	    while ( !complete.empty() && complete.begin()->first == next ){
+	      rec = complete.begin()->second;
+	      complete.erase( complete.begin() );
+	      ++next;
+	      if ( !failed.load() ){
+		sort( rec->unparsed.begin(), rec->unparsed.end() );
+		for ( const auto& i : rec->unparsed ){
+		  LOG << "WARNING!" << endl;
+		  LOG << "Sentence " << i+1
+		      << " isn't parsed because it contains more tokens then set with the --max-parser-tokens="
+		      << options.maxParserTokens << " option." << endl;
+		}
+		showResults( os, *rec->doc, &rec->records );
+		os.flush();
+	      }
+	      delete rec->doc;
+	      delete rec;
+	    }
+	  }
+	  else if ( done ){
+	    break;
+	  }
+	  else {
+	    pipe_backoff( spins );
+	  }
+	}
+      } ) );
+  // the tokenizer
+  string chunk;
+  size_t seq = 0;
+  while ( !failed.load()
+	  && read_chunk( is, chunk, options.doSentencePerLine ) ){
+    if ( is_empty_line( chunk ) ){
+      continue;
+    }
+    Document *doc = 0;
+    vector<Sentence*> sentences;
+    try {
+      timers.tokTimer.start();
+      doc = tokenizer->tokenizestring( chunk );
+      timers.tokTimer.stop();
+      addDeclarations( *doc );
+      if ( options.doQuoteDetection ){
+	sentences = doc->sentenceParts();
+      }
+      else {
+	sentences = doc->sentences();
+      }
+    }
+    catch ( exception& e ){
+      lock_guard<mutex> lock( error_mutex );
+      exs += string(e.what()) + " ";
+      failed.store( true );
+      delete doc;
+      break;
+    }
+    if ( sentences.empty() ){
+      delete doc;
+      continue;
+    }
+    DocRecord *rec = new DocRecord();
+    rec->doc = doc;
+    rec->seq = seq++;
+    rec->size = sentences.size();
+    rec->done = 0;
+    for ( size_t i=0; i < sentences.size(); ++i ){
+      PipeItem *item = new PipeItem();
+      item->rec = rec;
+      item->sent = sentences[i];
+      item->index = i;
+      item->skip = false;
+      item->parsed = true;
+      string lan = sentences[i]->language();
+      if ( !options.language.empty()
+	   && options.language != "none"
+	   && !lan.empty()
+	   && lan != options.language ){
+	if  (options.debugFlag >= 0){
+	  LOG << "Not processing sentence " << i+1 << endl
+	      << " different language: " << lan << endl
+	      << " --language=" << options.language << endl;
+	}
+	item->skip = true;
+      }
+      else if ( options.doQuoteDetection ){
+	item->words = sentences[i]->wordParts();
+      }
+      else {
+	item->words = sentences[i]->words();
+      }
+      queues[0]->push( item );
+    }
+  }
+  --producers[0];
+  for ( auto& t : threads ){
+    t.join();
+  }
+  timers.frogTimer.stop();
+  for ( const auto& q : queues ){
+    delete q;
+  }
+  if ( failed.load() ){
+    throw runtime_error( exs );
+  }
 }
 
-void FrogAPI::FrogFile( const string& infilename,
-			ostream &os,
-			const string& xmlOutF ) {
-  // stuff the whole input into one FoLiA document.
-  // This is not a good idea on the long term, I think (agreed [proycon] )
+static string xml_out_name( const string& infilename,
+			    const string& xmlOutF,
+			    bool doXMLin ){
+  // FoLiA output is compressed like the FoLiA input
   string xmlOutFile = xmlOutF;
-  if ( options.doXMLin && !xmlOutFile.empty() ){
+  if ( doXMLin && !xmlOutFile.empty() ){
     if ( match_back( infilename, ".gz" ) ){
       if ( !match_back( xmlOutFile, ".gz" ) )
 	xmlOutFile += ".gz";
@@ -1324,6 +1475,15 @@ void FrogAPI::FrogFile( const string& infilename,
 	xmlOutFile += ".bz2";
     }
   }
+  return xmlOutFile;
+}
+
+void FrogAPI::FrogFile( const string& infilename,
+			ostream &os,
+			const string& xmlOutF ) {
+  // when FoLiA output is requested, we stuff the whole input into one
+  // FoLiA document. Otherwise plain text is streamed, see FrogStream()
+  string xmlOutFile = xml_out_name( infilename, xmlOutF, options.doXMLin );
   if ( options.doXMLin ){
     Document doc;
     try {
@@ -1334,29 +1494,169 @@ void FrogAPI::FrogFile( const string& infilename,
       cerr << e.what() << endl;
       return;
     }
-    timers.reset();
+    resetTimers();
     timers.tokTimer.start();
     tokenizer->tokenize( doc );
     timers.tokTimer.stop();
-    FrogDoc( doc );
+    SentenceRecords records;
+    FrogDoc( doc, false, &records );
     if ( !xmlOutFile.empty() ){
       doc.save( xmlOutFile, options.doKanon );
       LOG << "resulting FoLiA doc saved in " << xmlOutFile << endl;
     }
-    showResults( os, doc );
+    showResults( os, doc, &records );
+  }
+  else if ( xmlOutFile.empty() ){
+    // no FoLiA output wanted, so we don't need the whole document at once
+    ifstream IN( infilename );
+    resetTimers();
+    if ( doPipeline ){
+      FrogPipeline( IN, os );
+    }
+    else {
+      FrogStream( IN, os, 0 );
+    }
+    showTimers();
   }
   else {
     ifstream IN( infilename );
-    timers.reset();
+    resetTimers();
     timers.tokTimer.start();
     Document *doc = tokenizer->tokenize( IN );
     timers.tokTimer.stop();
-    FrogDoc( *doc );
+    SentenceRecords records;
+    FrogDoc( *doc, false, &records );
     if ( !xmlOutFile.empty() ){
       doc->save( xmlOutFile, options.doKanon );
       LOG << "resulting FoLiA doc saved in " << xmlOutFile << endl;
     }
-    showResults( os, *doc );
+    showResults( os, *doc, &records );
+    delete doc;
+  }
+}
+
+void FrogAPI::FrogFile( const string& infilename,
+			ostream &os,
+			const string& xmlOutF,
+			FrogWorker& w ) {
+  // frog one file using worker w only, so other workers are free to handle
+  // other files at the same time.
+  string xmlOutFile = xml_out_name( infilename, xmlOutF, options.doXMLin );
+  if ( options.doXMLin ){
+    Document doc;
+    doc.readFromFile( infilename );
+    w.timers.tokTimer.start();
+    w.myTokenizer->tokenize( doc );
+    w.timers.tokTimer.stop();
+    SentenceRecords records;
+    TestDocument( doc, &w, nullptr, &records );
+    if ( !xmlOutFile.empty() ){
+      doc.save( xmlOutFile, options.doKanon );
+      LOG << "resulting FoLiA doc saved in " << xmlOutFile << endl;
+    }
+    showResults( os, doc, &records );
+  }
+  else if ( xmlOutFile.empty() ){
+    ifstream IN( infilename );
+    FrogStream( IN, os, &w );
+  }
+  else {
+    ifstream IN( infilename );
+    w.timers.tokTimer.start();
+    Document *doc = w.myTokenizer->tokenize( IN );
+    w.timers.tokTimer.stop();
+    SentenceRecords records;
+    TestDocument( *doc, &w, nullptr, &records );
+    doc->save( xmlOutFile, options.doKanon );
+    LOG << "resulting FoLiA doc saved in " << xmlOutFile << endl;
+    showResults( os, *doc, &records );
     delete doc;
   }
 }
+
+void FrogAPI::FrogFiles( const vector<FrogJob>& jobs, ostream& os ){
+  // Frog a set of files. Results go to the outName of a job, or to os when
+  // that is empty.
+  // With more then 1 worker, every worker takes whole files, and frogs
+  // them on its own. This pays off for lots of small files. The workers
+  // share the models, except for the taggers (see initWorker()).
+  // Results for os are buffered per file, and written in input order.
+  size_t numW = workers.size();
+  if ( numW < 2 || jobs.size() < 2 ){
+    for ( const auto& job : jobs ){
+      ostream *out = &os;
+      ofstream *outS = 0;
+      if ( !job.outName.empty() ){
+	outS = new ofstream( job.outName );
+	out = outS;
+      }
+      LOG << "Frogging " << job.inName << endl;
+      try {
+	FrogFile( job.inName, *out, job.xmlName );
+	if ( outS ){
+	  LOG << "results stored in " << job.outName << endl;
+	}
+      }
+      catch ( exception& e ){
+	LOG << "problem frogging: " << job.inName << endl
+	    << e.what() << endl;
+      }
+      delete outS;
+    }
+    return;
+  }
+  resetTimers();
+  timers.frogTimer.start();
+  map<size_t,string> pending;
+  size_t next = 0;
+#pragma omp parallel for schedule(dynamic) num_threads(numW)
+  for ( size_t i=0; i < jobs.size(); ++i ){
+#ifdef HAVE_OPENMP
+    FrogWorker& w = *workers[omp_get_thread_num()];
+#else
+    FrogWorker& w = *workers[0];
+#endif
+    if ( !w.myTokenizer ){
+      // only the first worker got a tokenizer at startup
+#pragma omp critical(ucto_init)
+      {
+	w.myTokenizer = initTokenizer();
+      }
+    }
+    const FrogJob& job = jobs[i];
+    stringstream buffer;
+    ostream *out = &buffer;
+    ofstream *outS = 0;
+    if ( !job.outName.empty() ){
+      outS = new ofstream( job.outName );
+      out = outS;
+    }
+    LOG << "Frogging " << job.inName << endl;
+    try {
+      if ( !w.myTokenizer ){
+	throw runtime_error( "tokenizer initialization failed" );
+      }
+      FrogFile( job.inName, *out, job.xmlName, w );
+      if ( outS ){
+	LOG << "results stored in " << job.outName << endl;
+      }
+    }
+    catch ( exception& e ){
+      LOG << "problem frogging: " << job.inName << endl
+	  << e.what() << endl;
+    }
+    delete outS;
+#pragma omp critical(frog_output)
+    {
+      pending[i] = buffer.str();
+      while ( !pending.empty() && pending.begin()->first == next ){
+	os << pending.begin()->second;
+	pending.erase( pending.begin() );
+	++next;
+      }
+    }
+  }
+  timers.frogTimer.stop();
+  LOG << "Frogging " << jobs.size() << " files on " << numW
+      << " workers took: " << timers.frogTimer << endl;
+}
@@ -51,12 +51,6 @@ using TiCC::operator<<;
 
 #define LOG *TiCC::Log(parseLog)
 
-TiCC::Timer prepareTimer;
-TiCC::Timer relsTimer;
-TiCC::Timer pairsTimer;
-TiCC::Timer dirTimer;
-TiCC::Timer csiTimer;
-
 struct parseData {
   void clear() { words.clear(); heads.clear(); mods.clear(); mwus.clear(); }
   vector<string> words;
@@ -141,6 +135,10 @@ bool Parser::init( const TiCC::Configuration& configuration ){
       problem = true;
     }
   }
+  for ( size_t i=0; i <= maxDepSpan; ++i ){
+    leftDistances.push_back( "LEFT " + TiCC::toString( i ) );
+    rightDistances.push_back( "RIGHT " + TiCC::toString( i ) );
+  }
   val = configuration.lookUp( "pairsFile", "parser" );
   if ( !val.empty() ){
     pairsFileName = prefix( cDir, val );
@@ -226,6 +224,32 @@ bool Parser::init( const TiCC::Configuration& configuration ){
   return happy;
 }
 
+bool Parser::init( const Parser& master ){
+  // take over the settings of an initialized Parser, and share its Timbl
+  // trees. Only the buffers for the instances are our own.
+  // The master must outlive us.
+  if ( !master.isInit ){
+    return false;
+  }
+  version = master.version;
+  dep_tagset = master.dep_tagset;
+  POS_tagset = master.POS_tagset;
+  MWU_tagset = master.MWU_tagset;
+  textclass = master.textclass;
+  maxDepSpanS = master.maxDepSpanS;
+  maxDepSpan = master.maxDepSpan;
+  leftDistances = master.leftDistances;
+  rightDistances = master.rightDistances;
+  if ( master.filter ){
+    filter = new Tokenizer::UnicodeFilter( *master.filter );
+  }
+  pairs = new Timbl::TimblAPI( *master.pairs );
+  dir = new Timbl::TimblAPI( *master.dir );
+  rels = new Timbl::TimblAPI( *master.rels );
+  isInit = true;
+  return true;
+}
+
 Parser::~Parser(){
   delete rels;
   delete dir;
@@ -234,24 +258,36 @@ Parser::~Parser(){
   delete filter;
 }
 
-static vector<Word *> lookup( Word *word,
-			      const vector<Entity*>& entities ){
-  vector<Word*> vec;
-  for ( const auto& ent : entities ){
-    vec = ent->select<Word>();
-    if ( !vec.empty() ){
-      if ( vec[0]->id() == word->id() ) {
-	// cerr << "found " << vec << endl;
-	return vec;
-      }
-    }
+static const string& field( const vector<string>& v, size_t i, int offset ){
+  // the feature of token i+offset, or "__" outside the sentence
+  static const string none = "__";
+  if ( ( offset < 0 && i < size_t(-offset) )
+       || i + offset >= v.size() ){
+    return none;
   }
-  vec.clear();
-  return vec;
+  return v[i+offset];
+}
+
+static void add_window( string& inst, const vector<string>& v, size_t i ){
+  // append the features of the tokens before, at and after i
+  inst += field( v, i, -1 );
+  inst += ' ';
+  inst += v[i];
+  inst += ' ';
+  inst += field( v, i, 1 );
+}
+
+void timbl( Timbl::TimblAPI* tim,
+	    const string& inst,
+	    vector<timbl_result>& results ){
+  const Timbl::ValueDistribution *db;
+  const Timbl::TargetValue *tv = tim->Classify( inst, db );
+  results.push_back( timbl_result( tv->Name(), db->Confidence(tv), db ) );
 }
 
-vector<string> Parser::createPairInstances( const parseData& pd ){
-  vector<string> instances;
+void Parser::classifyPairs( const parseData& pd,
+			    vector<timbl_result>& results ){
+  results.clear();
   const vector<string>& words = pd.words;
   const vector<string>& heads = pd.heads;
   const vector<string>& mods = pd.mods;
@@ -260,142 +296,75 @@ vector<string> Parser::createPairInstances( const parseData& pd ){
       "__ " + words[0] + " __ ROOT ROOT ROOT __ " + heads[0]
       + " __ ROOT ROOT ROOT "+ words[0] +"^ROOT ROOT ROOT ROOT^"
       + heads[0] + " _";
-    instances.push_back( inst );
+    timbl( pairs, inst, results );
+    return;
   }
-  else {
-    for ( size_t i=0 ; i < words.size(); ++i ){
-      string word_1, word0, word1;
-      string tag_1, tag0, tag1;
-      string mods0;
-      if ( i == 0 ){
-	word_1 = "__";
-	tag_1 = "__";
-      }
-      else {
-	word_1 = words[i-1];
-	tag_1 = heads[i-1];
-      }
-      word0 = words[i];
-      tag0 = heads[i];
-      mods0 = mods[i];
-      if ( i == words.size() - 1 ){
-	word1 = "__";
-	tag1 = "__";
+  // every instance combines the windows of two tokens, so we build
+  // those once. All strings keep their room for the next sentence
+  wordWindows.resize( words.size() );
+  tagWindows.resize( words.size() );
+  for ( size_t i=0 ; i < words.size(); ++i ){
+    wordWindows[i].clear();
+    add_window( wordWindows[i], words, i );
+    tagWindows[i].clear();
+    add_window( tagWindows[i], heads, i );
+  }
+  string& inst = pairInst;
+  for ( size_t i=0 ; i < words.size(); ++i ){
+    inst.clear();
+    inst += wordWindows[i];
+    inst += " ROOT ROOT ROOT ";
+    inst += tagWindows[i];
+    inst += " ROOT ROOT ROOT ";
+    inst += heads[i];
+    inst += "^ROOT ROOT ROOT ROOT^";
+    inst += mods[i];
+    inst += " _";
+    timbl( pairs, inst, results );
+  }
+  for ( size_t wPos=0; wPos < words.size(); ++wPos ){
+    for ( size_t pos=0; pos < words.size(); ++pos ){
+      if ( pos > wPos + maxDepSpan ){
+	break;
+      }
+      if ( pos == wPos ){
+	continue;
+      }
+      if ( pos + maxDepSpan < wPos ){
+	continue;
+      }
+      inst.clear();
+      inst += wordWindows[wPos];
+      inst += ' ';
+      inst += wordWindows[pos];
+      inst += ' ';
+      inst += tagWindows[wPos];
+      inst += ' ';
+      inst += tagWindows[pos];
+      inst += ' ';
+      inst += heads[wPos];
+      inst += '^';
+      inst += heads[pos];
+      inst += ' ';
+      if ( wPos > pos ){
+	inst += leftDistances[wPos - pos];
       }
       else {
-	word1 = words[i+1];
-	tag1 = heads[i+1];
-      }
-      string inst = word_1 + " " + word0 + " " + word1
-	+ " ROOT ROOT ROOT " + tag_1 + " "
-	+ tag0 + " " + tag1 + " ROOT ROOT ROOT " + tag0
-	+ "^ROOT ROOT ROOT ROOT^" + mods0 + " _";
-      instances.push_back( inst );
-    }
-    //
-    for ( size_t wPos=0; wPos < words.size(); ++wPos ){
-      string w_word_1, w_word0, w_word1;
-      string w_tag_1, w_tag0, w_tag1;
-      string w_mods0;
-      if ( wPos == 0 ){
-	w_word_1 = "__";
-	w_tag_1 = "__";
-      }
-      else {
-	w_word_1 = words[wPos-1];
-	w_tag_1 = heads[wPos-1];
-      }
-      w_word0 = words[wPos];
-      w_tag0 = heads[wPos];
-      w_mods0 = mods[wPos];
-      if ( wPos == words.size()-1 ){
-	w_word1 = "__";
-	w_tag1 = "__";
-      }
-      else {
-	w_word1 = words[wPos+1];
-	w_tag1 = heads[wPos+1];
-      }
-      for ( size_t pos=0; pos < words.size(); ++pos ){
-	if ( pos > wPos + maxDepSpan ){
-	  break;
-	}
-	if ( pos == wPos ){
-	  continue;
-	}
-	if ( pos + maxDepSpan < wPos ){
-	  continue;
-	}
-	string inst = w_word_1 + " " + w_word0 + " " + w_word1;
-
-	if ( pos == 0 ){
-	  inst += " __";
-	}
-	else {
-	  inst += " " + words[pos-1];
-	}
-	if ( pos < words.size() ){
-	  inst += " " + words[pos];
-	}
-	else {
-	  inst += " __";
-	}
-	if ( pos < words.size()-1 ){
-	  inst += " " + words[pos+1];
-	}
-	else {
-	  inst += " __";
-	}
-	inst += " " + w_tag_1 + " " + w_tag0 + " " + w_tag1;
-	if ( pos == 0 ){
-	  inst += " __";
-	}
-	else {
-	  inst += " " + heads[pos-1];
-	}
-	if ( pos < words.size() ){
-	  inst += " " + heads[pos];
-	}
-	else {
-	  inst += " __";
-	}
-	if ( pos < words.size()-1 ){
-	  inst += " " + heads[pos+1];
-	}
-	else {
-	  inst += " __";
-	}
-
-	inst += " " + w_tag0 + "^";
-	if ( pos < words.size() ){
-	  inst += heads[pos];
-	}
-	else {
-	  inst += "__";
-	}
-
-	if ( wPos > pos ){
-	  inst += " LEFT " + TiCC::toString( wPos - pos );
-	}
-	else {
-	  inst += " RIGHT "+ TiCC::toString( pos - wPos );
-	}
-	if ( pos >= words.size() ){
-	  inst += " __";
-	}
-	else {
-	  inst += " " + mods[pos];
-	}
-	inst += "^" + w_mods0 + " __";
-	instances.push_back( inst );
-      }
+	inst += rightDistances[pos - wPos];
+      }
+      inst += ' ';
+      inst += mods[pos];
+      inst += '^';
+      inst += mods[wPos];
+      inst += " __";
+      timbl( pairs, inst, results );
     }
   }
-  return instances;
 }
 
-vector<string> Parser::createDirInstances( const parseData& pd ){
-  vector<string> d_instances;
+void Parser::classifyDirs( const parseData& pd,
+                           vector<timbl_result>& results ){
+  results.clear();
   const vector<string>& words = pd.words;
   const vector<string>& heads = pd.heads;
   const vector<string>& mods = pd.mods;
@@ -408,7 +377,7 @@ vector<string> Parser::createDirInstances( const parseData& pd ){
       + " __ __ __ __ " + word0 + "^" + tag0
       + " __ __ __^" + tag0 + " " + tag0 +"^__ __ " + mod0
       + " __ ROOT";
-    d_instances.push_back( inst );
+    timbl( dir, inst, results );
   }
   else if ( words.size() == 2 ){
     string word0 = words[0];
@@ -432,7 +401,7 @@ vector<string> Parser::createDirInstances( const parseData& pd ){
       + " " + mod0
       + " " + mod1
       + " ROOT";
-    d_instances.push_back( inst );
+    timbl( dir, inst, results );
     inst = string("__")
       + " " + word0
       + " " + word1
@@ -449,7 +418,7 @@ vector<string> Parser::createDirInstances( const parseData& pd ){
       + " " + mod1
       + " __"
       + " ROOT";
-    d_instances.push_back( inst );
+    timbl( dir, inst, results );
   }
   else if ( words.size() == 3 ) {
     string word0 = words[0];
@@ -479,7 +448,7 @@ vector<string> Parser::createDirInstances( const parseData& pd ){
       + " " + mod0
       + " " + mod1
       + " ROOT";
-    d_instances.push_back( inst );
+    timbl( dir, inst, results );
     inst = string("__")
       + " " + word0
       + " " + word1
@@ -499,7 +468,7 @@ vector<string> Parser::createDirInstances( const parseData& pd ){
       + " " + mod1
       + " " + mod2
       + " ROOT";
-    d_instances.push_back( inst );
+    timbl( dir, inst, results );
     inst = word0
       + " " + word1
       + " " + word2
@@ -518,96 +487,46 @@ vector<string> Parser::createDirInstances( const parseData& pd ){
       + " " + mod2
       + " __"
       + " ROOT";
-    d_instances.push_back( inst );
+    timbl( dir, inst, results );
   }
   else {
+    string& inst = dirInst;
     for ( size_t i=0 ; i < words.size(); ++i ){
-      string word_0, word_1, word_2;
-      string tag_0, tag_1, tag_2;
-      string mod_0, mod_1, mod_2;
-      if ( i == 0 ){
-	word_2 = "__";
-	tag_2 = "__";
-	mod_2 = "__";
-	word_1 = "__";
-	tag_1 = "__";
-	mod_1 = "__";
-      }
-      else if ( i == 1 ){
-	word_2 = "__";
-	tag_2 = "__";
-	mod_2 = "__";
-	word_1 = words[i-1];
-	tag_1 = heads[i-1];
-	mod_1 = mods[i-1];
-      }
-      else {
-	word_2 = words[i-2];
-	tag_2 = heads[i-2];
-	mod_2 = mods[i-2];
-	word_1 = words[i-1];
-	tag_1 = heads[i-1];
-	mod_1 = mods[i-1];
-      }
-      string word0 = words[i];
-      string word1, word2;
-      string tag0 = heads[i];
-      string tag1, tag2;
-      string mod0 = mods[i];
-      string mod1, mod2;
-      if ( i < words.size() - 2 ){
-	word1 = words[i+1];
-	tag1 = heads[i+1];
-	mod1 = mods[i+1];
-	word2 = words[i+2];
-	tag2 = heads[i+2];
-	mod2 = mods[i+2];
-      }
-      else if ( i == words.size() - 2 ){
-	word1 = words[i+1];
-	tag1 = heads[i+1];
-	mod1 = mods[i+1];
-	word2 = "__";
-	tag2 = "__";
-	mod2 = "__";
-      }
-      else {
-	word1 = "__";
-	tag1 = "__";
-	mod1 = "__";
-	word2 = "__";
-	tag2 = "__";
-	mod2 = "__";
-      }
-      string inst = word_2
-	+ " " + word_1
-	+ " " + word0
-	+ " " + word1
-	+ " " + word2
-	+ " " + tag_2
-	+ " " + tag_1
-	+ " " + tag0
-	+ " " + tag1
-	+ " " + tag2
-	+ " " + word_2 + "^" + tag_2
-	+ " " + word_1 + "^" + tag_1
-	+ " " + word0 + "^" + tag0
-	+ " " + word1 + "^" + tag1
-	+ " " + word2 + "^" + tag2
-	+ " " + tag_1 + "^" + tag0
-	+ " " + tag0 + "^" + tag1
-	+ " " + mod_1
-	+ " " + mod0
-	+ " " + mod1
-	+ " ROOT";
-      d_instances.push_back( inst );
+      inst.clear();
+      for ( int j=-2; j <= 2; ++j ){
+	inst += field( words, i, j );
+	inst += ' ';
+      }
+      for ( int j=-2; j <= 2; ++j ){
+	inst += field( heads, i, j );
+	inst += ' ';
+      }
+      for ( int j=-2; j <= 2; ++j ){
+	inst += field( words, i, j );
+	inst += '^';
+	inst += field( heads, i, j );
+	inst += ' ';
+      }
+      inst += field( heads, i, -1 );
+      inst += '^';
+      inst += heads[i];
+      inst += ' ';
+      inst += heads[i];
+      inst += '^';
+      inst += field( heads, i, 1 );
+      for ( int j=-1; j <= 1; ++j ){
+	inst += ' ';
+	inst += field( mods, i, j );
+      }
+      inst += " ROOT";
+      timbl( dir, inst, results );
     }
   }
-  return d_instances;
 }
 
-vector<string> Parser::createRelInstances( const parseData& pd ){
-  vector<string> r_instances;
+void Parser::classifyRels( const parseData& pd,
+                           vector<timbl_result>& results ){
+  results.clear();
   const vector<string>& words = pd.words;
   const vector<string>& heads = pd.heads;
   const vector<string>& mods = pd.mods;
@@ -620,7 +539,7 @@ vector<string> Parser::createRelInstances( const parseData& pd ){
       + " __ __ "  + tag0 + " __ __ __^" + tag0
       + " " + tag0 + "^__ __^__^" + tag0
       + " " + tag0 + "^__^__ __";
-    r_instances.push_back( inst );
+    timbl( rels, inst, results );
   }
   else if ( words.size() == 2 ){
     string word0 = words[0];
@@ -644,7 +563,7 @@ vector<string> Parser::createRelInstances( const parseData& pd ){
       + " __^__^" + tag0
       + " " + tag0 + "^" + tag1 + "^__"
       + " __";
-    r_instances.push_back( inst );
+    timbl( rels, inst, results );
     inst = string("__")
       + " " + word0
       + " " + word1
@@ -659,7 +578,7 @@ vector<string> Parser::createRelInstances( const parseData& pd ){
       + " __^" + tag0 + "^" + tag1
       + " " + tag1 + "^__^__"
       + " __";
-    r_instances.push_back( inst );
+    timbl( rels, inst, results );
   }
   else if ( words.size() == 3 ) {
     string word0 = words[0];
@@ -686,7 +605,7 @@ vector<string> Parser::createRelInstances( const parseData& pd ){
       + " __^__^" + tag0
       + " " + tag0 + "^" + tag1 + "^" + tag2
       + " __";
-    r_instances.push_back( inst );
+    timbl( rels, inst, results );
     inst = string("__")
       + " " + word0
       + " " + word1
@@ -703,7 +622,7 @@ vector<string> Parser::createRelInstances( const parseData& pd ){
       + " __^" + tag0 + "^" + tag1
       + " " + tag1 + "^" + tag2 + "^__"
       + " __";
-    r_instances.push_back( inst );
+    timbl( rels, inst, results );
     inst = word0
       + " " + word1
       + " " + word2
@@ -718,88 +637,45 @@ vector<string> Parser::createRelInstances( const parseData& pd ){
       + " " + tag0 + "^" + tag1 + "^" + tag2
       + " " + tag2 + "^__^__"
       + " __";
-    r_instances.push_back( inst );
+    timbl( rels, inst, results );
   }
   else {
+    string& inst = relInst;
     for ( size_t i=0 ; i < words.size(); ++i ){
-      string word_0, word_1, word_2;
-      string tag_0, tag_1, tag_2;
-      string mod_0, mod_1, mod_2;
-      if ( i == 0 ){
-	word_2 = "__";
-	tag_2 = "__";
-	mod_2 = "__";
-	word_1 = "__";
-	tag_1 = "__";
-	mod_1 = "__";
-      }
-      else if ( i == 1 ){
-	word_2 = "__";
-	tag_2 = "__";
-	mod_2 = "__";
-	word_1 = words[i-1];
-	tag_1 = heads[i-1];
-	mod_1 = mods[i-1];
-      }
-      else {
-	word_2 = words[i-2];
-	tag_2 = heads[i-2];
-	mod_2 = mods[i-2];
-	word_1 = words[i-1];
-	tag_1 = heads[i-1];
-	mod_1 = mods[i-1];
-      }
-      string word0 = words[i];
-      string word1, word2;
-      string tag0 = heads[i];
-      string tag1, tag2;
-      string mod0 = mods[i];
-      string mod1, mod2;
-      if ( i < words.size() - 2 ){
-	word1 = words[i+1];
-	tag1 = heads[i+1];
-	mod1 = mods[i+1];
-	word2 = words[i+2];
-	tag2 = heads[i+2];
-	mod2 = mods[i+2];
-      }
-      else if ( i == words.size() - 2 ){
-	word1 = words[i+1];
-	tag1 = heads[i+1];
-	mod1 = mods[i+1];
-	word2 = "__";
-	tag2 = "__";
-	mod2 = "__";
-      }
-      else {
-	word1 = "__";
-	tag1 = "__";
-	mod1 = "__";
-	word2 = "__";
-	tag2 = "__";
-	mod2 = "__";
-      }
-      //
-      string inst = word_2
-	+ " " + word_1
-	+ " " + word0
-	+ " " + word1
-	+ " " + word2
-	+ " " + mod0
-	+ " " + tag_2
-	+ " " + tag_1
-	+ " " + tag0
-	+ " " + tag1
-	+ " " + tag2
-	+ " " + tag_1 + "^" + tag0
-	+ " " + tag0 + "^" + tag1
-	+ " " + tag_2 + "^" + tag_1 + "^" + tag0
-	+ " " + tag0 + "^" + tag1 + "^" + tag2
-	+ " __";
-      r_instances.push_back( inst );
+      inst.clear();
+      for ( int j=-2; j <= 2; ++j ){
+	inst += field( words, i, j );
+	inst += ' ';
+      }
+      inst += mods[i];
+      for ( int j=-2; j <= 2; ++j ){
+	inst += ' ';
+	inst += field( heads, i, j );
+      }
+      inst += ' ';
+      inst += field( heads, i, -1 );
+      inst += '^';
+      inst += heads[i];
+      inst += ' ';
+      inst += heads[i];
+      inst += '^';
+      inst += field( heads, i, 1 );
+      inst += ' ';
+      inst += field( heads, i, -2 );
+      inst += '^';
+      inst += field( heads, i, -1 );
+      inst += '^';
+      inst += heads[i];
+      inst += ' ';
+      inst += heads[i];
+      inst += '^';
+      inst += field( heads, i, 1 );
+      inst += '^';
+      inst += field( heads, i, 2 );
+      inst += " __";
+      timbl( rels, inst, results );
     }
   }
-  return r_instances;
 }
 
 
@@ -812,82 +688,67 @@ void Parser::addDeclaration( Document& doc ) const {
   }
 }
 
-parseData Parser::prepareParse( const vector<Word *>& fwords ){
-  parseData pd;
-  Sentence *sent = 0;
-  vector<Entity*> entities;
-#pragma omp critical(foliaupdate)
-  {
-    sent = fwords[0]->sentence();
-    entities = sent->select<Entity>(MWU_tagset);
+static string join_features( const vector<string>& feats ){
+  string result;
+  for ( const auto& feat : feats ){
+    result += feat;
+    if ( &feat != &feats.back() ){
+      result += "|";
+    }
   }
-  for ( size_t i=0; i < fwords.size(); ++i ){
-    Word *word = fwords[i];
-    vector<Word*> mwuv = lookup( word, entities );
-    if ( !mwuv.empty() ){
+  return result;
+}
+
+parseData Parser::prepareParse( const SentenceRecord& rec ){
+  // the MWU's are taken from the record, as marked by the MWU chunker
+  parseData pd;
+  auto mwu_it = rec.mwus.begin();
+  for ( size_t i=0; i < rec.size(); ++i ){
+    if ( mwu_it != rec.mwus.end() && mwu_it->first == i ){
+      size_t len = mwu_it->second;
+      ++mwu_it;
       string multi_word;
       string head;
       string mod;
-      for ( const auto& mwu : mwuv ){
-	UnicodeString tmp;
-#pragma omp critical(foliaupdate)
-	{
-	  tmp = mwu->text( textclass );
-	}
+      vector<Word*> mwuv;
+      for ( size_t j=i; j < i+len; ++j ){
+	UnicodeString tmp = rec.text[j];
 	if ( filter )
 	  tmp = filter->filter( tmp );
 	string ms = UnicodeToUTF8( tmp );
 	multi_word += ms;
-	PosAnnotation *postag = mwu->annotation<PosAnnotation>( POS_tagset );
-	head += postag->feat("head");
-	vector<Feature*> feats = postag->select<Feature>();
-	for ( const auto& feat : feats ){
-	  mod += feat->cls();
-	  if ( &feat != &feats.back() ){
-	    mod += "|";
-	  }
-	}
-	if ( &mwu != &mwuv.back() ){
+	head += rec.heads[j];
+	mod += join_features( rec.features[j] );
+	if ( j < i+len-1 ){
 	  multi_word += "_";
 	  head += "_";
 	  mod += "_";
 	}
+	mwuv.push_back( rec.words[j] );
       }
       pd.words.push_back( multi_word );
       pd.heads.push_back( head );
       pd.mods.push_back( mod );
       pd.mwus.push_back( mwuv );
-      i += mwuv.size()-1;
+      i += len-1;
     }
     else {
-      UnicodeString tmp;
-#pragma omp critical(foliaupdate)
-      {
-	tmp = word->text( textclass );
-      }
+      UnicodeString tmp = rec.text[i];
       if ( filter )
 	tmp = filter->filter( tmp );
       string ms = UnicodeToUTF8( tmp );
       pd.words.push_back( ms );
-      PosAnnotation *postag = word->annotation<PosAnnotation>( POS_tagset );
-      string head = postag->feat("head");
-      pd.heads.push_back( head );
+      pd.heads.push_back( rec.heads[i] );
       string mod;
-      vector<Feature*> feats = postag->select<Feature>();
-      if ( feats.empty() ){
+      if ( rec.features[i].empty() ){
 	mod = "__";
       }
       else {
-	for ( const auto& feat : feats ){
-	  mod += feat->cls();
-	  if ( &feat != &feats.back() ){
-	    mod += "|";
-	  }
-	}
+	mod = join_features( rec.features[i] );
       }
       pd.mods.push_back( mod );
       vector<Word*> vec;
-      vec.push_back(word);
+      vec.push_back( rec.words[i] );
       pd.mwus.push_back( vec );
     }
   }
@@ -895,7 +756,7 @@ parseData Parser::prepareParse( const vector<Word *>& fwords ){
 }
 
 void appendResult( const vector<Word *>& words,
-		   parseData& pd,
+		   const parseData& pd,
 		   const string& tagset,
 		   const vector<int>& nums,
 		   const vector<string>& roles ){
@@ -904,62 +765,48 @@ void appendResult( const vector<Word *>& words,
   args["generate_id"] = sent->id();
   args["set"] = tagset;
   DependenciesLayer *dl = new DependenciesLayer( args, sent->doc() );
-#pragma omp critical(foliaupdate)
-  {
-    sent->append( dl );
-  }
+  sent->append( dl );
   for ( size_t i=0; i < nums.size(); ++i ){
     if ( nums[i] != 0 ){
       KWargs args;
       args["generate_id"] = dl->id();
       args["class"] = roles[i];
       args["set"] = tagset;
-#pragma omp critical(foliaupdate)
-      {
-	Dependency *d = new Dependency( args, sent->doc() );
-	dl->append( d );
-	Headspan *dh = new Headspan();
-	for ( const auto& wrd : pd.mwus[nums[i]-1] ){
-	  dh->append( wrd );
-	}
-	d->append( dh );
-	DependencyDependent *dd = new DependencyDependent();
-	for ( const auto& it : pd.mwus[i] ){
-	  dd->append( it );
-	}
-	d->append( dd );
-      }
+      Dependency *d = new Dependency( args, sent->doc() );
+      dl->append( d );
+      Headspan *dh = new Headspan();
+      for ( const auto& wrd : pd.mwus[nums[i]-1] ){
+	dh->append( wrd );
+      }
+      d->append( dh );
+      DependencyDependent *dd = new DependencyDependent();
+      for ( const auto& it : pd.mwus[i] ){
+	dd->append( it );
+      }
+      d->append( dd );
     }
   }
 }
 
 void appendParseResult( const vector<Word *>& words,
-			parseData& pd,
+			const parseData& pd,
 			const string& tagset,
-			const vector<parsrel>& res ){
+			const vector<parsrel>& res,
+			AnnotationBuffer& buf ){
   vector<int> nums;
   vector<string> roles;
   for ( const auto& it : res ){
     nums.push_back( it.head );
     roles.push_back( it.deprel );
   }
-  appendResult( words, pd, tagset, nums, roles );
+  buf.add( [words,pd,tagset,nums,roles](){
+      appendResult( words, pd, tagset, nums, roles ); } );
 }
 
-void timbl( Timbl::TimblAPI* tim,
-	    const vector<string>& instances,
-	    vector<timbl_result>& results ){
-  results.clear();
-  for ( const auto& inst : instances ){
-    const Timbl::ValueDistribution *db;
-    const Timbl::TargetValue *tv = tim->Classify( inst, db );
-    results.push_back( timbl_result( tv->Name(), db->Confidence(tv), db ) );
-  }
-}
-
-void Parser::Parse( const vector<Word*>& words,
-		    TimerBlock& timers ){
-  timers.parseTimer.start();
+void Parser::Parse( SentenceRecord& rec,
+		    TimerBlock& timers,
+		    AnnotationBuffer& buf ){
+  const vector<Word*>& words = rec.words;
   if ( !isInit ){
     LOG << "Parser is not initialized! EXIT!" << endl;
     throw runtime_error( "Parser is not initialized!" );
@@ -968,9 +815,10 @@ void Parser::Parse( const vector<Word*>& words,
     LOG << "unable to parse an analisis without words" << endl;
     return;
   }
+  timers.parseTimer.start();
   timers.prepareTimer.start();
-  parseData pd = prepareParse( words );
-  timers.prepareTimer.stop();
+  parseData pd = prepareParse( rec );
+  timers.prepareTimer.stop( words.size() );
   vector<timbl_result> p_results;
   vector<timbl_result> d_results;
   vector<timbl_result> r_results;
@@ -979,23 +827,20 @@ void Parser::Parse( const vector<Word*>& words,
 #pragma omp section
       {
 	timers.pairsTimer.start();
-	vector<string> instances = createPairInstances( pd );
-	timbl( pairs, instances, p_results );
-	timers.pairsTimer.stop();
+	classifyPairs( pd, p_results );
+	timers.pairsTimer.stop( words.size() );
       }
 #pragma omp section
       {
 	timers.dirTimer.start();
-	vector<string> instances = createDirInstances( pd );
-	timbl( dir, instances, d_results );
-	timers.dirTimer.stop();
+	classifyDirs( pd, d_results );
+	timers.dirTimer.stop( words.size() );
       }
 #pragma omp section
       {
 	timers.relsTimer.start();
-	vector<string> instances = createRelInstances( pd );
-	timbl( rels, instances, r_results );
-	timers.relsTimer.stop();
+	classifyRels( pd, r_results );
+	timers.relsTimer.stop( words.size() );
       }
   }
 
@@ -1005,7 +850,13 @@ void Parser::Parse( const vector<Word*>& words,
 			       d_results,
 			       pd.words.size(),
 			       maxDepSpan );
-  timers.csiTimer.stop();
-  appendParseResult( words, pd, dep_tagset, res );
-  timers.parseTimer.stop();
+  timers.csiTimer.stop( words.size() );
+  rec.dep_heads.clear();
+  rec.dep_rels.clear();
+  for ( const auto& it : res ){
+    rec.dep_heads.push_back( it.head );
+    rec.dep_rels.push_back( it.deprel );
+  }
+  appendParseResult( words, pd, dep_tagset, res, buf );
+  timers.parseTimer.stop( words.size() );
 }
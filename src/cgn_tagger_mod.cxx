@@ -208,47 +208,62 @@ string CGNTagger::getSubSet( const string& val, const string& head ){
 			   "' whithin the constraints for '" + head + "'" );
 }
 
-void CGNTagger::post_process( const vector<folia::Word *>& words ){
-  for ( auto const& word : words ){
-    folia::PosAnnotation *postag = 0;
-#pragma omp critical(foliaupdate)
-    {
-      postag = word->annotation<folia::PosAnnotation>( );
-    }
-    string cls = postag->cls();
+void CGNTagger::post_process( SentenceRecord& rec, AnnotationBuffer& buf ){
+  // split the tags in a head and features, for the record and for FoLiA
+  vector<vector<string>> subsets( rec.size() );
+  for ( size_t i=0; i < rec.size(); ++i ){
     vector<string> parts;
-    TiCC::split_at_first_of( cls, parts, "()" );
+    TiCC::split_at_first_of( rec.tags[i], parts, "()" );
     string head = parts[0];
+    rec.heads[i] = head;
+    if ( head == "SPEC" ){
+      rec.confidences[i] = 1.0;
+    }
+    if ( parts.size() > 1 ){
+      TiCC::split_at( parts[1], rec.features[i], "," );
+      for ( auto const& part : rec.features[i] ){
+	subsets[i].push_back( getSubSet( part, head ) );
+      }
+    }
+  }
+  const vector<folia::Word*>& words = rec.words;
+  const vector<string>& heads = rec.heads;
+  const vector<vector<string>>& feats = rec.features;
+  buf.add( [this,words,heads,feats,subsets](){
+      add_features( words, heads, feats, subsets ); } );
+}
+
+void CGNTagger::add_features( const vector<folia::Word *>& words,
+			      const vector<string>& heads,
+			      const vector<vector<string>>& feats,
+			      const vector<vector<string>>& subsets ) const {
+  // called from an AnnotationBuffer commit, after the PoS tags are added
+  for ( size_t i=0; i < words.size(); ++i ){
+    folia::PosAnnotation *postag
+      = words[i]->annotation<folia::PosAnnotation>( );
     folia::KWargs args;
-    args["class"]  = head;
+    args["class"]  = heads[i];
     args["set"]    = tagset;
     folia::Feature *feat = new folia::HeadFeature( args );
     postag->append( feat );
-    if ( head == "SPEC" ){
+    if ( heads[i] == "SPEC" ){
       postag->confidence(1.0);
     }
-    if ( parts.size() > 1 ){
-      vector<string> tagParts;
-      TiCC::split_at( parts[1], tagParts, "," );
-      for ( auto const& part : tagParts ){
-	folia::KWargs args;
-	args["set"]    = tagset;
-	args["subset"] = getSubSet( part, head );
-	args["class"]  = part;
-#pragma omp critical(foliaupdate)
-	{
-	  folia::Feature *feat = new folia::Feature( args );
-	  postag->append( feat );
-	}
-      }
+    for ( size_t j=0; j < feats[i].size(); ++j ){
+      folia::KWargs args;
+      args["set"]    = tagset;
+      args["subset"] = subsets[i][j];
+      args["class"]  = feats[i][j];
+      folia::Feature *feat = new folia::Feature( args );
+      postag->append( feat );
     }
   }
 }
 
-void CGNTagger::Classify( const vector<folia::Word*>& swords ){
-  POSTagger::Classify( swords );
+void CGNTagger::Classify( SentenceRecord& rec, AnnotationBuffer& buf ){
+  POSTagger::Classify( rec, buf );
   if ( debug ){
     LOG << "POS Classify done:" << endl;
   }
-  post_process( swords );
+  post_process( rec, buf );
 }
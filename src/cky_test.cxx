@@ -0,0 +1,95 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2017
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+
+*/
+// regression tests for the constraint bookkeeping of the CKY parser
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "frog/ckyparser.h"
+
+using namespace std;
+
+static bool too_many( size_t numTokens, size_t token,
+		      size_t incoming, size_t directions,
+		      string& message ){
+  // give token more constraints than fit in its ConstraintBits and
+  // report the complaint of the parser
+  ConstraintSet constraints( numTokens );
+  for ( size_t i=0; i < incoming; ++i ){
+    constraints.addIncoming( token, "rel" + to_string( i ), 0.5 );
+  }
+  for ( size_t i=0; i < directions; ++i ){
+    constraints.addDirection( token, ( i % 2 ) ? "LEFT" : "RIGHT", 0.5 );
+  }
+  try {
+    CKYParser parser( constraints );
+    parser.parse();
+    vector<parsrel> result( numTokens );
+    parser.rightComplete( 0, numTokens, result );
+  }
+  catch ( const range_error& e ){
+    message = e.what();
+    return true;
+  }
+  return false;
+}
+
+int main(){
+  int failures = 0;
+  const size_t numTokens = 3;
+  for ( size_t token=1; token <= numTokens; ++token ){
+    // 70 constraints: too many, also on the last token
+    string message;
+    string wanted = "CKYParser: too many constraints for token "
+      + to_string( token );
+    if ( !too_many( numTokens, token, 40, 30, message ) ){
+      cerr << "FAIL: no error for 70 constraints on token " << token << endl;
+      ++failures;
+    }
+    else if ( message != wanted ){
+      cerr << "FAIL: got '" << message << "' instead of '"
+	   << wanted << "'" << endl;
+      ++failures;
+    }
+    // 64 constraints just fit
+    if ( too_many( numTokens, token, 40, 24, message ) ){
+      cerr << "FAIL: 64 constraints on token " << token << " rejected: "
+	   << message << endl;
+      ++failures;
+    }
+  }
+  if ( failures == 0 ){
+    cout << "cky_test: OK" << endl;
+  }
+  return failures == 0 ? 0 : 1;
+}
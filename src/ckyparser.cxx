@@ -32,242 +32,370 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <stdexcept>
+#include <cstdlib>
+#include <algorithm>
 
 #include "ticcutils/PrettyPrint.h"
 #include "frog/ckyparser.h"
 
 using namespace std;
 
-ostream& operator<<( ostream& os, const Constraint* c ){
-  if ( c ){
-    c->put( os );
-  }
-  else
-    os << "None";
-  return os;
-}
+// sentences shorter than this are parsed on one thread
+const size_t PARALLEL_THRESHOLD = 40;
 
-ostream& operator<<( ostream& os, const Constraint& c ){
-  return os << &c;
+RelationTable::RelationTable(){
+  // the labels the parser makes up itself
+  intern( "None" );
+  intern( "ROOT" );
 }
 
-void HasIncomingRel::put( ostream& os ) const {
-  Constraint::put( os );
-  os << " incoming rel=" << relType;
+int RelationTable::intern( const string& rel ){
+  auto it = ids.find( rel );
+  if ( it != ids.end() ){
+    return it->second;
+  }
+  int id = names.size();
+  ids.insert( make_pair( rel, id ) );
+  names.push_back( rel );
+  return id;
 }
 
-
-void HasDependency::put( ostream& os ) const {
-  Constraint::put( os );
-  os << " dependency rel=" << relType << " head=" << headType;
+void ConstraintSet::addDependency( int dep, int head,
+				   const string& rel, double w ){
+  dependencies.push_back( DependencyConstraint{ dep, head,
+	relations.intern( rel ), w } );
 }
 
-void DependencyDirection::put( ostream & os ) const {
-  Constraint::put( os );
-  os << " direction=" << " " << direction;
+void ConstraintSet::addDirection( int token, const string& d, double w ){
+  dirType dir;
+  if ( d == "ROOT" )
+    dir = ROOT;
+  else if ( d == "LEFT" )
+    dir = LEFT;
+  else if ( d == "RIGHT" )
+    dir = RIGHT;
+  else {
+    abort();
+  }
+  directions.push_back( DirectionConstraint{ token, dir, w } );
 }
 
+void ConstraintSet::addIncoming( int token, const string& rel, double w ){
+  incoming.push_back( IncomingConstraint{ token, relations.intern( rel ), w } );
+}
 
-CKYParser::CKYParser( size_t num, const vector<const Constraint*>& constraints ):
-  numTokens(num)
+CKYParser::CKYParser( const ConstraintSet& constraints ):
+  numTokens( constraints.numTokens ),
+  relations( constraints.relations ),
+  band(0)
 {
-  inDepConstraints.resize( numTokens + 1 );
-  outDepConstraints.resize( numTokens + 1 );
-  edgeConstraints.resize( numTokens + 1 );
-  for ( auto& it : edgeConstraints ){
-    it.resize( numTokens + 1 );
+  // the parser only proposes heads close to their dependent (maxDepSpan),
+  // so we only need room for the edges within that distance
+  for ( const auto& c : constraints.dependencies ){
+    if ( c.head != 0 ){
+      size_t dist = abs( c.head - c.dep );
+      band = max( band, dist );
+    }
+  }
+  // store the constraints by token, in the order we got them. We number
+  // the incoming and direction constraints of every token, so we can keep
+  // sets of them as bits. (The edge constraints are never looked up, so
+  // we don't track those)
+  vector<size_t> used( numTokens + 1, 0 );
+  inDepConstraints.init( numTokens + 1 );
+  for ( const auto& c : constraints.incoming ){
+    inDepConstraints.count( c.token );
+    ++used[c.token];
+  }
+  inDepConstraints.allocate();
+  outDepConstraints.init( numTokens + 1 );
+  for ( const auto& c : constraints.directions ){
+    outDepConstraints.count( c.token );
+    ++used[c.token];
+  }
+  outDepConstraints.allocate();
+  for ( size_t i=0; i <= numTokens; ++i ){
+    if ( used[i] > 8 * sizeof(ConstraintBits) ){
+      throw range_error( "CKYParser: too many constraints for token "
+			 + to_string( i ) );
+    }
+    used[i] = 0;
+  }
+  edgeConstraints.init( edgeSlot( numTokens + 1, 0 ) );
+  for ( const auto& c : constraints.dependencies ){
+    edgeConstraints.count( edgeSlot( c.dep, c.head ) );
+  }
+  edgeConstraints.allocate();
+  for ( const auto& c : constraints.dependencies ){
+    Edge& e = edgeConstraints.place( edgeSlot( c.dep, c.head ) );
+    e.rel = c.rel;
+    e.weight = c.weight;
+  }
+  for ( const auto& c : constraints.incoming ){
+    Incoming& in = inDepConstraints.place( c.token );
+    in.rel = c.rel;
+    in.weight = c.weight;
+    in.bit = ConstraintBits(1) << used[c.token]++;
+  }
+  for ( const auto& c : constraints.directions ){
+    Direction& out = outDepConstraints.place( c.token );
+    out.dir = c.dir;
+    out.weight = c.weight;
+    out.bit = ConstraintBits(1) << used[c.token]++;
   }
   chart.resize( numTokens +1 );
   for ( auto& it : chart ){
     it.resize( numTokens + 1 );
   }
-  for ( const auto& constraint : constraints ){
-    addConstraint( constraint );
-  }
-
 }
 
+size_t CKYParser::edgeSlot( size_t depIndex, size_t headIndex ) const {
+  // every dependent has one slot for the root, followed by one for every
+  // head from depIndex-band to depIndex+band
+  size_t slot = depIndex * ( 2 * band + 2 );
+  if ( headIndex == 0 ){
+    return slot;
+  }
+  return slot + 1 + headIndex + band - depIndex;
+}
 
-void CKYParser::addConstraint( const Constraint *c ){
-  switch ( c->type() ){
-  case Constraint::Incoming:
-    inDepConstraints[c->tIndex()].push_back( c );
-    break;
-  case Constraint::Dependency:
-    edgeConstraints[c->tIndex()][c->hIndex()].push_back( c );
-    break;
-  case Constraint::Direction:
-    outDepConstraints[c->tIndex()].push_back( c );
-    break;
-  default:
-    cerr << "UNSUPPORTED constraint type" << endl;
-    abort();
+SlotArray<CKYParser::Edge>::Range CKYParser::edges( size_t depIndex,
+						    size_t headIndex ) const {
+  // the edge constraints from headIndex to depIndex
+  size_t dist = ( headIndex > depIndex ) ? headIndex - depIndex
+    : depIndex - headIndex;
+  if ( headIndex != 0 && dist > band ){
+    return SlotArray<Edge>::Range{ 0, 0 };
   }
+  return edgeConstraints[edgeSlot( depIndex, headIndex )];
+}
+
+bool CKYParser::fixedEdge( size_t headIndex, size_t depIndex ) const {
+  // does the best edge from headIndex to depIndex not depend on the
+  // subtrees below it? True for the root, which ignores them, and when
+  // there are no edge constraints, as for every span longer than the band
+  return headIndex == 0 || edges( depIndex, headIndex ).empty();
 }
 
-string CKYParser::bestEdge( const SubTree& leftSubtree,
-			    const SubTree& rightSubtree,
-			    size_t headIndex, size_t depIndex,
-			    set<const Constraint*>& bestConstraints,
-			    double& bestScore ){
-  bestConstraints.clear();
+int CKYParser::bestEdge( const SubTree& leftSubtree,
+			 const SubTree& rightSubtree,
+			 size_t headIndex, size_t depIndex,
+			 ConstraintBits& headBits,
+			 ConstraintBits& depBits,
+			 double& bestScore ) const {
+  // find the best labeled edge from headIndex to depIndex, which are the
+  // first and the last token of the span covered by leftSubtree and
+  // rightSubtree. Return its label, with the constraints of head and
+  // dependent it satisfies in headBits and depBits.
+  // A constraint of a token can only be satisfied in the subtree that
+  // holds the token, as one of its ends
+  headBits = 0;
+  depBits = 0;
   //  cerr << "BESTEDGE " << headIndex << " <> " << depIndex << endl;
   if ( headIndex == 0 ){
     bestScore = 0.0;
-    for ( auto const& constraint : outDepConstraints[depIndex] ){
-      //      cerr << "CHECK " << constraint << endl;
-      if ( constraint->direct() == dirType::ROOT ){
-	//	cerr << "head outdep matched " << constraint << endl;
-	bestScore = constraint->wght();
-	bestConstraints.insert( constraint );
+    for ( auto const& out : outDepConstraints[depIndex] ){
+      if ( out.dir == dirType::ROOT ){
+	bestScore = out.weight;
+	depBits |= out.bit;
       }
     }
-    string label = "ROOT";
-    for ( auto const& constraint : edgeConstraints[depIndex][0] ){
-      //      cerr << "head edge matched " << constraint << endl;
-      bestScore += constraint->wght();
-      bestConstraints.insert( constraint );
-      label = constraint->rel();
+    int label = RelationTable::ROOT_REL;
+    for ( auto const& edge : edges( depIndex, 0 ) ){
+      bestScore += edge.weight;
+      label = edge.rel;
     }
-    //    cerr << "best HEAD==>" << label << " " << bestScore << " " << bestConstraints << endl;
+    //    cerr << "best HEAD==>" << relations.name(label) << " " << bestScore << endl;
     return label;
   }
+  const ConstraintBits headSat = ( headIndex < depIndex )
+    ? leftSubtree.leftSat : rightSubtree.rightSat;
+  const ConstraintBits depSat = ( depIndex < headIndex )
+    ? leftSubtree.leftSat : rightSubtree.rightSat;
   bestScore = -0.5;
-  string bestLabel = "None";
-  for( auto const& edgeConstraint : edgeConstraints[depIndex][headIndex] ){
-    double my_score = edgeConstraint->wght();
-    string my_label = edgeConstraint->rel();
-    set<const Constraint *> my_constraints;
-    my_constraints.insert( edgeConstraint );
-    for( const auto& constraint : inDepConstraints[headIndex] ){
-      if ( constraint->rel() == my_label &&
-	   leftSubtree.satisfiedConstraints.find( constraint ) == leftSubtree.satisfiedConstraints.end() &&
-	   rightSubtree.satisfiedConstraints.find( constraint ) == rightSubtree.satisfiedConstraints.end() ){
-	//	cerr << "inDep matched: " << constraint << endl;
-	my_score += constraint->wght();
-	my_constraints.insert(constraint);
+  int bestLabel = RelationTable::NO_REL;
+  for( auto const& edge : edges( depIndex, headIndex ) ){
+    double my_score = edge.weight;
+    ConstraintBits my_head = 0;
+    ConstraintBits my_dep = 0;
+    for( const auto& in : inDepConstraints[headIndex] ){
+      if ( !( headSat & in.bit )
+	   && in.rel == edge.rel ){
+	my_score += in.weight;
+	my_head |= in.bit;
       }
     }
-    for( const auto& constraint : outDepConstraints[depIndex] ){
-      if ( ( ( constraint->direct() == LEFT &&
-	       headIndex < depIndex )
-	     ||
-	     ( constraint->direct() == RIGHT &&
-	       headIndex > depIndex ) )
-	   && leftSubtree.satisfiedConstraints.find( constraint ) == leftSubtree.satisfiedConstraints.end()
-	   && rightSubtree.satisfiedConstraints.find( constraint ) == rightSubtree.satisfiedConstraints.end() ){
-	//	cerr << "outdep matched: " << constraint << endl;
-	my_score += constraint->wght();
-	my_constraints.insert(constraint);
+    for( const auto& out : outDepConstraints[depIndex] ){
+      if ( !( depSat & out.bit )
+	   && ( ( out.dir == LEFT &&
+		  headIndex < depIndex )
+		||
+		( out.dir == RIGHT &&
+		  headIndex > depIndex ) ) ){
+	my_score += out.weight;
+	my_dep |= out.bit;
       }
     }
     if ( my_score > bestScore ){
       bestScore = my_score;
-      bestLabel = my_label;
-      bestConstraints = std::move(my_constraints);
-      //      cerr << "UPDATE BEst " << bestLabel << " " << bestScore << " " << bestConstraints << endl;
+      bestLabel = edge.rel;
+      headBits = my_head;
+      depBits = my_dep;
     }
   }
-  //  cerr << "GRAND TOTAL " << bestLabel << " " << bestScore << " " << bestConstraints << endl;
+  //  cerr << "GRAND TOTAL " << relations.name(bestLabel) << " " << bestScore << endl;
   return bestLabel;
 }
 
+static ConstraintBits bits_of( size_t token, const SubTree& tree,
+			       size_t first, size_t last ){
+  // the satisfied constraints of token in tree, which spans first..last
+  ConstraintBits result = 0;
+  if ( token == first ){
+    result |= tree.leftSat;
+  }
+  if ( token == last ){
+    result |= tree.rightSat;
+  }
+  return result;
+}
+
 void CKYParser::parse(){
+  // all cells with the same span length k only depend on shorter spans, so
+  // we fill each such diagonal of the chart in parallel. For short
+  // sentences that isn't worth the synchronization
+#pragma omp parallel if( numTokens >= PARALLEL_THRESHOLD )
   for ( size_t k=1; k < numTokens + 2; ++k ){
+#pragma omp for schedule(dynamic,4)
     for( size_t s=0; s < numTokens + 1 - k; ++s ){
-      size_t t = s + k;
-      double bestScore = -10E45;
-      int bestI = -1;
-      string bestL = "__";
-      set<const Constraint*> bestConstraints;
-      for( size_t r = s; r < t; ++r ){
-	double edgeScore = -0.5;
-	set<const Constraint*> constraints;
-	string label = bestEdge( chart[s][r].r_True,
-				 chart[r+1][t].l_True,
-				 t, s, constraints, edgeScore );
-	//	cerr << "STEP 1 BEST EDGE==> " << label << " ( " << edgeScore << ")" << endl;
-	double score = chart[s][r].r_True.score() + chart[r+1][t].l_True.score() + edgeScore;
-	if ( score > bestScore ){
-	  bestScore = score;
-	  bestI = r;
-	  bestL = label;
-	  bestConstraints = std::move(constraints);
-	}
-      }
-      //      cerr << "STEP 1 ADD: " << bestScore <<"-" << bestI << "-" << bestL << endl;
-      chart[s][t].l_False = SubTree( bestScore, bestI, bestL );
-      chart[s][t].l_False.satisfiedConstraints.insert( chart[s][bestI].r_True.satisfiedConstraints.begin(), chart[s][bestI].r_True.satisfiedConstraints.end() );
-      chart[s][t].l_False.satisfiedConstraints.insert( chart[bestI+1][t].l_True.satisfiedConstraints.begin(), chart[bestI+1][t].l_True.satisfiedConstraints.end() );
-      chart[s][t].l_False.satisfiedConstraints.insert( bestConstraints.begin(), bestConstraints.end() );
-
-      bestScore = -10E45;
-      bestI = -1;
-      bestL = "__";
-      bestConstraints.clear();
-      for ( size_t r = s; r < t; ++r ){
-	double edgeScore = -0.5;
-	set<const Constraint*> constraints;
-	string label = bestEdge( chart[s][r].r_True,
-				 chart[r+1][t].l_True,
-				 s, t, constraints, edgeScore );
-	//	cerr << "STEP 2 BEST EDGE==> " << label << " ( " << edgeScore << ")" << endl;
-	double score = chart[s][r].r_True.score() + chart[r+1][t].l_True.score() + edgeScore;
-	if ( score > bestScore ){
-	  bestScore = score;
-	  bestI = r;
-	  bestL = label;
-	  bestConstraints = std::move(constraints);
-	}
-      }
-
-      //      cerr << "STEP 2 ADD: " << bestScore <<"-" << bestI << "-" << bestL << endl;
-      chart[s][t].r_False = SubTree( bestScore, bestI, bestL );
-      chart[s][t].r_False.satisfiedConstraints.insert( chart[s][bestI].r_True.satisfiedConstraints.begin(), chart[s][bestI].r_True.satisfiedConstraints.end() );
-      chart[s][t].r_False.satisfiedConstraints.insert( chart[bestI+1][t].l_True.satisfiedConstraints.begin(), chart[bestI+1][t].l_True.satisfiedConstraints.end() );
-      chart[s][t].r_False.satisfiedConstraints.insert( bestConstraints.begin(), bestConstraints.end() );
-
-      bestI = -1;
-      bestL = "";
-      bestScore = -10E45;
-      for ( size_t r = s; r < t; ++r ){
-	double score = chart[s][r].l_True.score() + chart[r][t].l_False.score();
-	if ( score > bestScore ){
-	  bestScore = score;
-	  bestI = r;
-	}
-      }
-      //      cerr << "STEP 3 ADD: " << bestScore <<"-" << bestI << "-" << bestL << endl;
-      chart[s][t].l_True = SubTree( bestScore, bestI, bestL );
-      chart[s][t].l_True.satisfiedConstraints.insert( chart[s][bestI].l_True.satisfiedConstraints.begin(), chart[s][bestI].l_True.satisfiedConstraints.end() );
-      chart[s][t].l_True.satisfiedConstraints.insert( chart[bestI][t].l_False.satisfiedConstraints.begin(), chart[bestI][t].l_False.satisfiedConstraints.end() );
-
-      bestI = -1;
-      bestL = "";
-      bestScore = -10E45;
-      for ( size_t r = s+1; r < t+1; ++r ){
-	double score = chart[s][r].r_False.score() + chart[r][t].r_True.score();
-	if ( score > bestScore ){
-	  bestScore = score;
-	  bestI = r;
-	}
-      }
-
-      //      cerr << "STEP 4 ADD: " << bestScore <<"-" << bestI << "-" << bestL << endl;
-      chart[s][t].r_True = SubTree( bestScore, bestI, bestL );
-      chart[s][t].r_True.satisfiedConstraints.insert( chart[s][bestI].r_False.satisfiedConstraints.begin(), chart[s][bestI].r_False.satisfiedConstraints.end() );
-      chart[s][t].r_True.satisfiedConstraints.insert( chart[bestI][t].r_True.satisfiedConstraints.begin(), chart[bestI][t].r_True.satisfiedConstraints.end() );
+      fillCell( s, s + k );
+    }
+  }
+}
 
+void CKYParser::fillCell( size_t s, size_t t ){
+  // step 1 adds an edge from t to s, step 2 one from s to t. Both
+  // join the same subtrees, for every split point r. When an edge
+  // doesn't depend on those subtrees, we only look for it once
+  const bool fixed1 = fixedEdge( t, s );
+  const bool fixed2 = fixedEdge( s, t );
+  double fixedScore1 = -0.5;
+  double fixedScore2 = -0.5;
+  ConstraintBits fixedHead1 = 0;
+  ConstraintBits fixedDep1 = 0;
+  ConstraintBits fixedHead2 = 0;
+  ConstraintBits fixedDep2 = 0;
+  int fixedLabel1 = -1;
+  int fixedLabel2 = -1;
+  if ( fixed1 ){
+    fixedLabel1 = bestEdge( chart[s][s].r_True, chart[s+1][t].l_True,
+			    t, s, fixedHead1, fixedDep1, fixedScore1 );
+  }
+  if ( fixed2 ){
+    fixedLabel2 = bestEdge( chart[s][s].r_True, chart[s+1][t].l_True,
+			    s, t, fixedHead2, fixedDep2, fixedScore2 );
+  }
+  double bestScore1 = -10E45;
+  int bestI1 = -1;
+  int bestL1 = -1;
+  ConstraintBits bestHead1 = 0;
+  ConstraintBits bestDep1 = 0;
+  double bestScore2 = -10E45;
+  int bestI2 = -1;
+  int bestL2 = -1;
+  ConstraintBits bestHead2 = 0;
+  ConstraintBits bestDep2 = 0;
+  int label = -1;
+  for( size_t r = s; r < t; ++r ){
+    const SubTree& left = chart[s][r].r_True;
+    const SubTree& right = chart[r+1][t].l_True;
+    double sum = left.score() + right.score();
+    double edgeScore = fixedScore1;
+    ConstraintBits headBits = fixedHead1;
+    ConstraintBits depBits = fixedDep1;
+    if ( !fixed1 ){
+      label = bestEdge( left, right, t, s, headBits, depBits, edgeScore );
+      //      cerr << "STEP 1 BEST EDGE==> " << label << " ( " << edgeScore << ")" << endl;
+    }
+    double score = sum + edgeScore;
+    if ( score > bestScore1 ){
+      bestScore1 = score;
+      bestI1 = r;
+      bestL1 = fixed1 ? fixedLabel1 : label;
+      bestHead1 = headBits;
+      bestDep1 = depBits;
+    }
+    edgeScore = fixedScore2;
+    headBits = fixedHead2;
+    depBits = fixedDep2;
+    if ( !fixed2 ){
+      label = bestEdge( left, right, s, t, headBits, depBits, edgeScore );
+      //      cerr << "STEP 2 BEST EDGE==> " << label << " ( " << edgeScore << ")" << endl;
+    }
+    score = sum + edgeScore;
+    if ( score > bestScore2 ){
+      bestScore2 = score;
+      bestI2 = r;
+      bestL2 = fixed2 ? fixedLabel2 : label;
+      bestHead2 = headBits;
+      bestDep2 = depBits;
+    }
+  }
+  //      cerr << "STEP 1 ADD: " << bestScore1 <<"-" << bestI1 << "-" << bestL1 << endl;
+  chart[s][t].l_False = SubTree( bestScore1, bestI1, bestL1 );
+  chart[s][t].l_False.leftSat = chart[s][bestI1].r_True.leftSat | bestDep1;
+  chart[s][t].l_False.rightSat = chart[bestI1+1][t].l_True.rightSat | bestHead1;
+  //      cerr << "STEP 2 ADD: " << bestScore2 <<"-" << bestI2 << "-" << bestL2 << endl;
+  chart[s][t].r_False = SubTree( bestScore2, bestI2, bestL2 );
+  chart[s][t].r_False.leftSat = chart[s][bestI2].r_True.leftSat | bestHead2;
+  chart[s][t].r_False.rightSat = chart[bestI2+1][t].l_True.rightSat | bestDep2;
+
+  double bestScore = -10E45;
+  int bestI = -1;
+  int bestL = -1;
+  for ( size_t r = s; r < t; ++r ){
+    double score = chart[s][r].l_True.score() + chart[r][t].l_False.score();
+    if ( score > bestScore ){
+      bestScore = score;
+      bestI = r;
     }
   }
+  //      cerr << "STEP 3 ADD: " << bestScore <<"-" << bestI << "-" << bestL << endl;
+  chart[s][t].l_True = SubTree( bestScore, bestI, bestL );
+  chart[s][t].l_True.leftSat
+    = bits_of( s, chart[s][bestI].l_True, s, bestI )
+    | bits_of( s, chart[bestI][t].l_False, bestI, t );
+  chart[s][t].l_True.rightSat
+    = bits_of( t, chart[s][bestI].l_True, s, bestI )
+    | bits_of( t, chart[bestI][t].l_False, bestI, t );
+
+  bestI = -1;
+  bestL = -1;
+  bestScore = -10E45;
+  for ( size_t r = s+1; r < t+1; ++r ){
+    double score = chart[s][r].r_False.score() + chart[r][t].r_True.score();
+    if ( score > bestScore ){
+      bestScore = score;
+      bestI = r;
+    }
+  }
+
+  //      cerr << "STEP 4 ADD: " << bestScore <<"-" << bestI << "-" << bestL << endl;
+  chart[s][t].r_True = SubTree( bestScore, bestI, bestL );
+  chart[s][t].r_True.leftSat
+    = bits_of( s, chart[s][bestI].r_False, s, bestI )
+    | bits_of( s, chart[bestI][t].r_True, bestI, t );
+  chart[s][t].r_True.rightSat
+    = bits_of( t, chart[s][bestI].r_False, s, bestI )
+    | bits_of( t, chart[bestI][t].r_True, bestI, t );
 }
 
 
 void CKYParser::leftIncomplete( int s, int t, vector<parsrel>& pr ){
   int r = chart[s][t].l_False.r();
-  string label = chart[s][t].l_False.edgeLabel();
   if ( r >=0 ){
-    pr[s - 1].deprel = label;
+    pr[s - 1].deprel = relations.name( chart[s][t].l_False.edgeLabel() );
     pr[s - 1].head = t;
     rightComplete( s, r, pr );
     leftComplete( r + 1, t, pr );
@@ -276,9 +404,8 @@ void CKYParser::leftIncomplete( int s, int t, vector<parsrel>& pr ){
 
 void CKYParser::rightIncomplete( int s, int t, vector<parsrel>& pr ){
   int r = chart[s][t].r_False.r();
-  string label = chart[s][t].r_False.edgeLabel();
   if ( r >= 0 ) {
-    pr[t - 1].deprel = label;
+    pr[t - 1].deprel = relations.name( chart[s][t].r_False.edgeLabel() );
     pr[t - 1].head = s;
     rightComplete( s, r, pr );
     leftComplete( r + 1, t, pr );
@@ -0,0 +1,516 @@
+/* ex: set tabstop=8 expandtab: */
+/*
+  Copyright (c) 2006 - 2017
+  CLST  - Radboud University
+  ILK   - Tilburg University
+
+  This file is part of frog:
+
+  A Tagger-Lemmatizer-Morphological-Analyzer-Dependency-Parser for
+  several languages
+
+  frog is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  frog is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+  For questions and suggestions, see:
+      https://github.com/LanguageMachines/frog/issues
+  or send mail to:
+      lamasoftware (at ) science.ru.nl
+*/
+
+
+#include <string>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <cassert>
+#include "frog/FrogAPI.h"
+#include "frog/column_formatter.h"
+
+using namespace std;
+using namespace folia;
+using namespace TiCC;
+
+#define LOG *Log(theErrLog)
+
+ColumnFormatter::ColumnFormatter( const FrogOptions& options,
+				  const Configuration& configuration,
+				  LogStream *log ):
+  doLemma( options.doLemma ),
+  doMorph( options.doMorph ),
+  doDeepMorph( options.doDeepMorph ),
+  doIOB( options.doIOB ),
+  doNER( options.doNER ),
+  doParse( options.doParse ),
+  doQuoteDetection( options.doQuoteDetection ),
+  debugFlag( options.debugFlag ),
+  parserDebug( 0 ),
+  outputclass( options.outputclass ),
+  theErrLog( log )
+{
+  string val = configuration.lookUp( "debug", "parser" );
+  if ( !val.empty() && !stringTo( val, parserDebug ) ){
+    parserDebug = 0;
+  }
+}
+
+struct ColumnIndex {
+  // lookup tables for the columned output of one sentence, filled in one
+  // pass over its annotations
+  unordered_map<Word*,vector<Word*>> mwus; // first word ==> all words
+  unordered_map<Word*,string> ner;         // word ==> NER tag(s)
+  unordered_map<Word*,string> iob;         // word ==> IOB tag(s)
+  unordered_map<Word*,Dependency*> deps;   // dependent ==> dependency
+  unordered_map<FoliaElement*,int> enumeration; // word ==> output index
+};
+
+template <class T>
+static void index_bio( const vector<T*>& elements,
+		       bool upper,
+		       unordered_map<Word*,string>& tags ){
+  // assign the B- and I- tags of all elements to their words.
+  // when a word is in more then one element, the tags are concatenated
+  for ( const auto& element : elements ){
+    vector<Word*> wv = element->template select<Word>();
+    string cls = element->cls();
+    if ( upper ){
+      cls = uppercase( cls );
+    }
+    for ( size_t i=0; i < wv.size(); ++i ){
+      tags[wv[i]] += ( i == 0 ? "B-" : "I-" ) + cls;
+    }
+  }
+}
+
+void ColumnFormatter::indexSentence( Sentence *sentence,
+				     ColumnIndex& index ) const {
+  vector<Entity*> mwu_entities;
+  if ( !mwu_tagset.empty() ){
+    mwu_entities = sentence->select<Entity>( mwu_tagset );
+  }
+  vector<Dependency*> dependencies;
+  if ( !dep_tagset.empty() ){
+    dependencies = sentence->select<Dependency>( dep_tagset );
+  }
+  vector<Chunk*> iob_chunking;
+  if ( !iob_tagset.empty() ){
+    iob_chunking = sentence->select<Chunk>( iob_tagset );
+  }
+  vector<Entity*> ner_entities;
+  if ( !ner_tagset.empty() ){
+    ner_entities =  sentence->select<Entity>( ner_tagset );
+  }
+  static set<ElementType> excludeSet;
+  vector<Sentence*> parts = sentence->select<Sentence>( excludeSet );
+  if ( !doQuoteDetection ){
+    assert( parts.size() == 0 );
+  }
+  for ( auto const& part : parts ){
+    vector<Entity*> ents;
+    if ( !mwu_tagset.empty() ){
+      ents = part->select<Entity>( mwu_tagset );
+    }
+    mwu_entities.insert( mwu_entities.end(), ents.begin(), ents.end() );
+    vector<Dependency*> deps = part->select<Dependency>();
+    dependencies.insert( dependencies.end(), deps.begin(), deps.end() );
+    vector<Chunk*> chunks = part->select<Chunk>();
+    iob_chunking.insert( iob_chunking.end(), chunks.begin(), chunks.end() );
+    vector<Entity*> ners ;
+    if ( !ner_tagset.empty() ) {
+      ners = part->select<Entity>( ner_tagset );
+    }
+    ner_entities.insert( ner_entities.end(), ners.begin(), ners.end() );
+  }
+  for ( const auto& ent : mwu_entities ){
+    vector<Word*> vec = ent->select<Word>();
+    if ( !vec.empty() ){
+      // the first entity starting at a word wins
+      index.mwus.insert( make_pair( vec[0], vec ) );
+    }
+  }
+  if ( doNER ){
+    index_bio( ner_entities, true, index.ner );
+  }
+  if ( doIOB ){
+    index_bio( iob_chunking, false, index.iob );
+  }
+  if ( doParse ){
+    for ( const auto& dep : dependencies ){
+      try {
+	vector<DependencyDependent*> dv = dep->select<DependencyDependent>();
+	if ( !dv.empty() ){
+	  vector<Word*> wv = dv[0]->select<Word>();
+	  for ( const auto& w : wv ){
+	    // the first dependency found for a word wins
+	    index.deps.insert( make_pair( w, dep ) );
+	  }
+	}
+      }
+      catch ( exception& e ){
+	if ( parserDebug > 0 ){
+	  LOG << "get Dependency results failed: "
+			  << e.what() << endl;
+	}
+      }
+    }
+  }
+}
+
+vector<Word*> ColumnFormatter::lookup( Word *word,
+				       const ColumnIndex& index ) const {
+  const auto it = index.mwus.find( word );
+  if ( it != index.mwus.end() ){
+    return it->second;
+  }
+  vector<Word*> vec;
+  vec.push_back( word ); // single unit
+  return vec;
+}
+
+Dependency *ColumnFormatter::lookupDep( Word *word,
+					const ColumnIndex& index ) const{
+  const auto it = index.deps.find( word );
+  if ( it != index.deps.end() ){
+    return it->second;
+  }
+  return 0;
+}
+
+struct ColumnWord {
+  // what the columned output shows of one word
+  ColumnWord(): confidence( 1.0 ), tagged( false ), lemmatized( false ){};
+  string text;
+  string tag;
+  double confidence;
+  bool tagged;
+  string lemma;
+  bool lemmatized;
+  vector<string> morphs;
+  vector<string> compounds;
+  string ner; // the B- or I- tag(s), empty outside an entity
+  string iob; // the B- or I- tag(s), empty outside a chunk
+};
+
+struct ColumnUnit {
+  // one line of output: a word or a multi word unit, and the number of
+  // the unit it depends on (0 for none)
+  ColumnUnit(): head( 0 ){};
+  vector<ColumnWord> words;
+  size_t head;
+  string rel;
+};
+
+static string lookup_bio( Word *word,
+			  const unordered_map<Word*,string>& tags ){
+  const auto it = tags.find( word );
+  if ( it == tags.end() ){
+    return "";
+  }
+  return it->second;
+}
+
+ColumnWord ColumnFormatter::foliaWord( Word *word,
+				       const ColumnIndex& index ) const {
+  ColumnWord result;
+  try {
+    result.text = word->str( outputclass );
+    PosAnnotation *postag = word->annotation<PosAnnotation>( pos_tagset );
+    result.tag = postag->cls();
+    result.confidence = postag->confidence();
+    result.tagged = true;
+  }
+  catch ( exception& e ){
+    if  (debugFlag > 0){
+      LOG << "get Postag results failed: "
+		      << e.what() << endl;
+    }
+  }
+  if ( doLemma ){
+    try {
+      result.lemma = word->lemma(lemma_tagset);
+      result.lemmatized = true;
+    }
+    catch ( exception& e ){
+      if  (debugFlag > 0){
+	LOG << "get Lemma results failed: "
+			<< e.what() << endl;
+      }
+    }
+  }
+  if ( doMorph ){
+    // also covers doDeepMorph
+    try {
+      result.morphs = get_full_morph_analysis( word, outputclass );
+    }
+    catch ( exception& e ){
+      if  (debugFlag > 0){
+	LOG << "get Morph results failed: "
+			<< e.what() << endl;
+      }
+    }
+  }
+  if ( doDeepMorph ){
+    try {
+      result.compounds = get_compound_analysis( word );
+    }
+    catch ( exception& e ){
+      if  (debugFlag > 0){
+	LOG << "get Morph results failed: "
+			<< e.what() << endl;
+      }
+    }
+  }
+  if ( doNER ){
+    result.ner = lookup_bio( word, index.ner );
+  }
+  if ( doIOB ){
+    result.iob = lookup_bio( word, index.iob );
+  }
+  return result;
+}
+
+void ColumnFormatter::foliaUnits( Sentence *sentence,
+				  vector<ColumnUnit>& units ) const {
+  // collect the output of a sentence from its FoLiA annotations
+  vector<Word*> words = sentence->words();
+  ColumnIndex cindex;
+  indexSentence( sentence, cindex );
+  size_t index = 1;
+  vector<vector<Word*> > mwus;
+  for ( size_t i=0; i < words.size(); ++i ){
+    Word *word = words[i];
+    vector<Word*> mwu = lookup( word, cindex );
+    for ( size_t j=0; j < mwu.size(); ++j ){
+      cindex.enumeration[mwu[j]] = index;
+    }
+    mwus.push_back( mwu );
+    i += mwu.size()-1;
+    ++index;
+  }
+  for ( const auto& mwu : mwus ){
+    ColumnUnit unit;
+    for ( const auto& word : mwu ){
+      unit.words.push_back( foliaWord( word, cindex ) );
+    }
+    if ( doParse ){
+      Dependency *dep = lookupDep( mwu[0], cindex );
+      if ( dep ){
+	vector<Headspan*> w = dep->select<Headspan>();
+	if ( w[0]->index(0)->isinstance( PlaceHolder_t ) ){
+	  // only for quote detection: the head is a sentence part
+	  string indexS = w[0]->index(0)->str();
+	  FoliaElement *pnt = w[0]->index(0)->doc()->index(indexS);
+	  unit.head = cindex.enumeration.find(pnt->index(0))->second;
+	}
+	else {
+	  unit.head = cindex.enumeration.find(w[0]->index(0))->second;
+	}
+	unit.rel = dep->cls();
+      }
+    }
+    units.push_back( unit );
+  }
+}
+
+ColumnWord ColumnFormatter::recordWord( const SentenceRecord& rec,
+					size_t i ) const {
+  ColumnWord result;
+  result.text = UnicodeToUTF8( rec.text[i] );
+  result.tag = rec.tags[i];
+  result.confidence = rec.confidences[i];
+  result.tagged = true;
+  if ( doLemma ){
+    result.lemma = rec.lemmas[i];
+    result.lemmatized = true;
+  }
+  result.morphs = rec.morphs[i];
+  result.compounds = rec.compounds[i];
+  result.ner = uppercase( rec.entities[i] );
+  result.iob = rec.chunks[i];
+  return result;
+}
+
+void ColumnFormatter::recordUnits( const SentenceRecord& rec,
+				   vector<ColumnUnit>& units ) const {
+  // collect the output of a sentence from its record
+  auto mwu_it = rec.mwus.begin();
+  for ( size_t i=0; i < rec.size(); ++i ){
+    size_t len = 1;
+    if ( mwu_it != rec.mwus.end() && mwu_it->first == i ){
+      len = mwu_it->second;
+      ++mwu_it;
+    }
+    ColumnUnit unit;
+    for ( size_t j=i; j < i+len; ++j ){
+      unit.words.push_back( recordWord( rec, j ) );
+    }
+    size_t num = units.size();
+    if ( doParse && num < rec.dep_heads.size() ){
+      unit.head = rec.dep_heads[num];
+      unit.rel = rec.dep_rels[num];
+    }
+    units.push_back( unit );
+    i += len-1;
+  }
+}
+
+static string join_bio( const vector<ColumnWord>& words, bool ner ){
+  string endresult;
+  for ( const auto& word : words ){
+    const string& tag = ner ? word.ner : word.iob;
+    if ( tag.empty() ){
+      endresult += "O";
+    }
+    else {
+      endresult += tag;
+    }
+    if ( &word != &words.back() ){
+      endresult += "_";
+    }
+  }
+  return endresult;
+}
+
+void ColumnFormatter::displayMWU( ostream& os,
+				  size_t index,
+				  const ColumnUnit& unit ) const {
+  string wrd;
+  string pos;
+  string lemma;
+  string morph;
+  string comp;
+  double conf = 1;
+  const vector<ColumnWord>& mwu = unit.words;
+  for ( const auto& word : mwu ){
+    wrd += word.text;
+    if ( word.tagged ){
+      pos += word.tag;
+      if ( &word != &mwu.back() ){
+	wrd += "_";
+	pos += "_";
+      }
+      conf *= word.confidence;
+    }
+    if ( doLemma && word.lemmatized ){
+      lemma += word.lemma;
+      if ( &word != &mwu.back() ){
+	lemma += "_";
+      }
+    }
+    if ( doMorph ){
+      // also covers doDeepMorph
+      for ( const auto& m : word.morphs ){
+	morph += m;
+	if ( &m != &word.morphs.back() ){
+	  morph += "/";
+	}
+      }
+      if ( &word != &mwu.back() ){
+	morph += "_";
+      }
+    }
+    if ( doDeepMorph ){
+      for ( const auto& cp : word.compounds ){
+	if ( cp.empty() ){
+	  comp += "0";
+	}
+	else {
+	  comp += cp+"-compound";
+	}
+	if ( &cp != &word.compounds.back() ){
+	  morph += "/";
+	}
+      }
+      if ( &word != &mwu.back() ){
+	comp += "_";
+      }
+    }
+  }
+  os << index << "\t" << wrd << "\t" << lemma << "\t" << morph;
+  if ( doDeepMorph ){
+    if ( comp.empty() ){
+      comp = "0";
+    }
+    os << "\t" << comp;
+  }
+  os << "\t" << pos << "\t" << std::fixed << conf;
+}
+
+void ColumnFormatter::showUnits( ostream& os,
+				 const vector<ColumnUnit>& units ) const {
+  size_t index = 0;
+  for ( const auto& unit : units ){
+    displayMWU( os, ++index, unit );
+    if ( doNER ){
+      os << "\t" << join_bio( unit.words, true );
+    }
+    else {
+      os << "\t\t";
+    }
+    if ( doIOB ){
+      os << "\t" << join_bio( unit.words, false );
+    }
+    else {
+      os << "\t\t";
+    }
+    if ( doParse ){
+      if ( unit.head > 0 ){
+	os << "\t" << unit.head << "\t" << unit.rel;
+      }
+      else {
+	os << "\t"<< 0 << "\tROOT";
+      }
+    }
+    else {
+      os << "\t\t";
+    }
+    os << endl;
+  }
+  if ( !units.empty() ){
+    os << endl;
+  }
+}
+
+ostream& ColumnFormatter::show( ostream& os,
+				Document& doc,
+				const SentenceRecords *records ) const {
+  // the records are used for the sentences that have one, the others are
+  // taken from FoLiA
+  vector<Sentence*> sentences = doc.sentences();
+  for ( auto const& sentence : sentences ){
+    const SentenceRecord *rec = records ? records->find( sentence ) : 0;
+    if ( rec ){
+      showSentence( os, *rec );
+    }
+    else {
+      showSentence( os, sentence );
+    }
+  }
+  return os;
+}
+
+ostream& ColumnFormatter::showSentence( ostream& os,
+					Sentence *sentence ) const {
+  vector<ColumnUnit> units;
+  foliaUnits( sentence, units );
+  showUnits( os, units );
+  return os;
+}
+
+ostream& ColumnFormatter::showSentence( ostream& os,
+					const SentenceRecord& rec ) const {
+  vector<ColumnUnit> units;
+  recordUnits( rec, units );
+  showUnits( os, units );
+  return os;
+}
@@ -53,12 +53,12 @@ void split_dist( const vector< pair<string,double>>& dist,
   }
 }
 
-vector<const Constraint*> formulateWCSP( const vector<timbl_result>& d_res,
-				   const vector<timbl_result>& r_res,
-				   const vector<timbl_result>& p_res,
-				   size_t sent_len,
-				   size_t maxDist ){
-  vector<const Constraint*> constraints;
+void formulateWCSP( const vector<timbl_result>& d_res,
+		    const vector<timbl_result>& r_res,
+		    const vector<timbl_result>& p_res,
+		    size_t sent_len,
+		    size_t maxDist,
+		    ConstraintSet& constraints ){
   vector<timbl_result>::const_iterator pit = p_res.begin();
   for ( size_t dependent_id = 1;
 	dependent_id <= sent_len;
@@ -68,7 +68,7 @@ vector<const Constraint*> formulateWCSP( const vector<timbl_result>& d_res,
     ++pit;
     //    cerr << "class=" << top_class << " met conf " << conf << endl;
     if ( top_class != "__" ){
-      constraints.push_back( new HasDependency( dependent_id, 0 ,top_class, conf ) );
+      constraints.addDependency( dependent_id, 0, top_class, conf );
     }
   }
 
@@ -90,7 +90,7 @@ vector<const Constraint*> formulateWCSP( const vector<timbl_result>& d_res,
 	++pit;
 	//	cerr << "class=" << top_class << " met conf " << conf << endl;
 	if ( top_class != "__" ){
-	  constraints.push_back( new HasDependency(dependent_id,headId,top_class,conf));
+	  constraints.addDependency( dependent_id, headId, top_class, conf );
 	}
       }
     }
@@ -102,7 +102,7 @@ vector<const Constraint*> formulateWCSP( const vector<timbl_result>& d_res,
 	token_id <= sent_len;
 	++token_id ) {
     for ( auto const& d : dit->dist() ){
-      constraints.push_back( new DependencyDirection( token_id, d.first, d.second ) );
+      constraints.addDirection( token_id, d.first, d.second );
     }
     ++dit;
 
@@ -119,13 +119,12 @@ vector<const Constraint*> formulateWCSP( const vector<timbl_result>& d_res,
 	vector<string> clss;
 	TiCC::split_at( top_class, clss, "|" );
 	for( const auto& rel : clss ){
-	  constraints.push_back( new HasIncomingRel( rel_id, rel, splits[rel] ) );
+	  constraints.addIncoming( rel_id, rel, splits[rel] );
 	}
       }
       ++rit;
     }
   }
-  return constraints;
 }
 
 timbl_result::timbl_result( const string& cls,
@@ -144,14 +143,11 @@ vector<parsrel> parse( const vector<timbl_result>& p_res,
 		       const vector<timbl_result>& d_res,
 		       size_t parse_size,
 		       int maxDist ){
-  vector<const Constraint*> constraints
-    = formulateWCSP( d_res, r_res, p_res, parse_size, maxDist );
-  CKYParser parser( parse_size, constraints );
+  ConstraintSet constraints( parse_size );
+  formulateWCSP( d_res, r_res, p_res, parse_size, maxDist, constraints );
+  CKYParser parser( constraints );
   parser.parse();
   vector<parsrel> result( parse_size );
   parser.rightComplete(0, parse_size, result );
-  for ( const auto& constraint : constraints ){
-    delete constraint;
-  }
   return result;
 }
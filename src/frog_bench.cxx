@@ -0,0 +1,481 @@
+/* ex: set tabstop=8 expandtab: */
+
+#include <string>
+#include <iostream>
+#include <sstream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <sys/resource.h>
+
+#include "config.h"
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
+#include "ticcutils/LogStream.h"
+#include "ticcutils/Configuration.h"
+#include "ticcutils/CommandLine.h"
+#include "ticcutils/StringOps.h"
+#include "libfolia/folia.h"
+#include "frog/FrogAPI.h"
+#include "frog/ucto_tokenizer_mod.h"
+#include "frog/cgn_tagger_mod.h"
+#include "frog/iob_tagger_mod.h"
+#include "frog/ner_tagger_mod.h"
+#include "frog/mblem_mod.h"
+#include "frog/mbma_mod.h"
+#include "frog/mwu_chunker_mod.h"
+#include "frog/Parser.h"
+
+using namespace std;
+using namespace folia;
+using namespace TiCC;
+
+LogStream my_default_log( cerr, "", StampMessage ); // fall-back
+LogStream *theErrLog = &my_default_log;  // fill the externals
+
+vector<string> fileNames;
+string outFileName;
+int maxThreads = 1;
+int repeat = 1;
+
+Configuration configuration;
+static string configFileName = FrogAPI::defaultConfigFile();
+
+void usage( ) {
+  cout << endl << "frog-bench: measure the speed of Frog and its modules\n"
+       << "Options:\n";
+  cout << "\t -t <file>              Use 'file' as the corpus\n"
+       << "\t                        (or give the files as arguments)\n"
+       << "\t -c <filename>          Set configuration file (default "
+       << configFileName << ")\n"
+       << "\t -o <file>              Write the JSON report to 'file'\n"
+       << "\t                        (default: standard output)\n"
+       << "\t --threads=<n>          Measure the whole pipeline with 1 up to\n"
+       << "\t                        'n' threads. Default: 1\n"
+       << "\t --repeat=<n>           Run the corpus 'n' times. Default: 1\n"
+       << "\t -h. give some help.\n"
+       << "\t -V or --version .   Show version info.\n";
+}
+
+bool parse_args( TiCC::CL_Options& Opts ) {
+  if ( Opts.is_present( 'V' ) || Opts.is_present("version") ){
+    // we already did show what we wanted.
+    exit( EXIT_SUCCESS );
+  }
+  if ( Opts.is_present('h') ){
+    usage();
+    exit( EXIT_SUCCESS );
+  };
+  // is a config file specified?
+  Opts.extract( 'c', configFileName );
+  if ( configuration.fill( configFileName ) ){
+    cerr << "config read from: " << configFileName << endl;
+  }
+  else {
+    cerr << "failed to read configuration from! '" << configFileName << "'" << endl;
+    cerr << "did you correctly install the frogdata package?" << endl;
+    return false;
+  }
+  string value;
+  if ( Opts.extract( "threads", value ) ){
+    if ( !TiCC::stringTo<int>( value, maxThreads ) || maxThreads < 1 ){
+      cerr << "threads value should be a positive integer" << endl;
+      return false;
+    }
+  }
+  if ( Opts.extract( "repeat", value ) ){
+    if ( !TiCC::stringTo<int>( value, repeat ) || repeat < 1 ){
+      cerr << "repeat value should be a positive integer" << endl;
+      return false;
+    }
+  }
+  Opts.extract( 'o', outFileName );
+  if ( Opts.extract( 't', value ) ){
+    fileNames.push_back( value );
+  }
+  else {
+    fileNames = Opts.getMassOpts();
+  }
+  if ( fileNames.empty() ){
+    cerr << "no corpus given" << endl;
+    return false;
+  }
+  return true;
+}
+
+struct Sample {
+  // the time one module took for one sentence
+  size_t length;
+  double secs;
+};
+
+struct BenchModule {
+  // a module under test, and what we measured for it
+  string name;
+  function<void(SentenceRecord&, AnnotationBuffer&)> run;
+  double secs;
+  size_t tokens;
+  size_t sentences;
+  vector<Sample> samples;
+};
+
+struct PipelineRun {
+  int threads;
+  double init_secs;
+  double secs;
+};
+
+// sentences are grouped by their length in tokens, as the parser (and so
+// the total) doesn't scale linearly
+static const size_t bucket_bounds[] = { 5, 10, 20, 40, 80 };
+static const size_t num_buckets = sizeof(bucket_bounds)
+  / sizeof(bucket_bounds[0]) + 1;
+
+static size_t bucket( size_t length ){
+  size_t b = 0;
+  while ( b < num_buckets - 1 && length > bucket_bounds[b] ){
+    ++b;
+  }
+  return b;
+}
+
+static double percentile( const vector<double>& sorted, double p ){
+  // nearest rank
+  size_t rank = static_cast<size_t>( p * sorted.size() + 0.999999 );
+  if ( rank == 0 ){
+    rank = 1;
+  }
+  return sorted[min( rank, sorted.size() ) - 1];
+}
+
+static double seconds_since( const chrono::steady_clock::time_point& start ){
+  return chrono::duration<double>( chrono::steady_clock::now() - start )
+    .count();
+}
+
+static string json_string( const string& s ){
+  string result = "\"";
+  for ( const auto& c : s ){
+    switch ( c ){
+    case '"':
+      result += "\\\"";
+      break;
+    case '\\':
+      result += "\\\\";
+      break;
+    case '\n':
+      result += "\\n";
+      break;
+    case '\t':
+      result += "\\t";
+      break;
+    default:
+      result += c;
+    }
+  }
+  return result + "\"";
+}
+
+static void write_latencies( ostream& os, const vector<Sample>& samples ){
+  // p50/p95/p99 per sentence, in seconds, for every length bucket
+  vector<vector<double>> times( num_buckets );
+  for ( const auto& s : samples ){
+    times[bucket( s.length )].push_back( s.secs );
+  }
+  os << "[";
+  bool first = true;
+  for ( size_t b=0; b < num_buckets; ++b ){
+    if ( times[b].empty() ){
+      continue;
+    }
+    sort( times[b].begin(), times[b].end() );
+    if ( !first ){
+      os << ",";
+    }
+    first = false;
+    os << "\n        { \"min_tokens\": " << ( b == 0 ? 1 : bucket_bounds[b-1] + 1 );
+    if ( b < num_buckets - 1 ){
+      os << ", \"max_tokens\": " << bucket_bounds[b];
+    }
+    os << ", \"sentences\": " << times[b].size()
+       << ", \"p50\": " << percentile( times[b], 0.50 )
+       << ", \"p95\": " << percentile( times[b], 0.95 )
+       << ", \"p99\": " << percentile( times[b], 0.99 ) << " }";
+  }
+  os << " ]";
+}
+
+static void write_rates( ostream& os, double secs,
+			 size_t tokens, size_t sentences ){
+  os << "\"seconds\": " << secs
+     << ", \"tokens_per_sec\": " << ( secs > 0 ? tokens / secs : 0 )
+     << ", \"sentences_per_sec\": " << ( secs > 0 ? sentences / secs : 0 );
+}
+
+static long peak_rss_bytes(){
+  rusage usage;
+  if ( getrusage( RUSAGE_SELF, &usage ) != 0 ){
+    return -1;
+  }
+  return usage.ru_maxrss * 1024L; // Linux gives kilobytes
+}
+
+static UctoTokenizer *init_tokenizer(){
+  UctoTokenizer *tok = new UctoTokenizer( theErrLog );
+  if ( !tok->init( configuration ) ){
+    delete tok;
+    return 0;
+  }
+  tok->setUttMarker( "<utt>" );
+  tok->setOutputClass( "current" );
+  return tok;
+}
+
+bool bench_modules( const string& corpus,
+		    vector<BenchModule>& modules,
+		    BenchModule& tok ){
+  // run the corpus through every module on its own, one sentence at a
+  // time, in one thread. Every module gets the results of the modules
+  // before it, just like in Frog, but only its own work is timed
+  UctoTokenizer *tokenizer = init_tokenizer();
+  CGNTagger tagger( theErrLog );
+  IOBTagger iob( theErrLog );
+  NERTagger ner( theErrLog );
+  Mblem mblem( theErrLog );
+  Mbma mbma( theErrLog );
+  Mwu mwu( theErrLog );
+  Parser parser( theErrLog );
+  if ( !tokenizer
+       || !tagger.init( configuration )
+       || !iob.init( configuration )
+       || !ner.init( configuration )
+       || !mblem.init( configuration )
+       || !mbma.init( configuration )
+       || !mwu.init( configuration )
+       || !parser.init( configuration ) ){
+    cerr << "module initialization failed" << endl;
+    delete tokenizer;
+    return false;
+  }
+  tagger.set_eos_mark( "<utt>" );
+  iob.set_eos_mark( "<utt>" );
+  ner.set_eos_mark( "<utt>" );
+  MblemContext mblemContext( mblem );
+  MbmaContext mbmaContext( mbma );
+  TimerBlock parseTimers;
+  modules.clear();
+  modules.push_back( BenchModule{ "CGNTagger",
+	[&]( SentenceRecord& rec, AnnotationBuffer& buf ){
+	  tagger.Classify( rec, buf );
+	} } );
+  modules.push_back( BenchModule{ "IOBTagger",
+	[&]( SentenceRecord& rec, AnnotationBuffer& buf ){
+	  iob.Classify( rec, buf );
+	} } );
+  modules.push_back( BenchModule{ "NERTagger",
+	[&]( SentenceRecord& rec, AnnotationBuffer& buf ){
+	  ner.Classify( rec, buf );
+	} } );
+  modules.push_back( BenchModule{ "Mblem",
+	[&]( SentenceRecord& rec, AnnotationBuffer& buf ){
+	  mblem.Classify( rec, mblemContext, buf );
+	} } );
+  modules.push_back( BenchModule{ "Mbma",
+	[&]( SentenceRecord& rec, AnnotationBuffer& buf ){
+	  mbma.Classify( rec, mbmaContext, buf );
+	} } );
+  modules.push_back( BenchModule{ "Mwu",
+	[&]( SentenceRecord& rec, AnnotationBuffer& buf ){
+	  mwu.Classify( rec, buf );
+	} } );
+  modules.push_back( BenchModule{ "Parser",
+	[&]( SentenceRecord& rec, AnnotationBuffer& buf ){
+	  parser.Parse( rec, parseTimers, buf );
+	} } );
+  for ( auto& mod : modules ){
+    mod.secs = 0;
+    mod.tokens = 0;
+    mod.sentences = 0;
+  }
+  tok.name = "UctoTokenizer";
+  tok.secs = 0;
+  tok.tokens = 0;
+  tok.sentences = 0;
+  for ( int r=0; r < repeat; ++r ){
+    // every run starts from a fresh document, without annotations
+    auto start = chrono::steady_clock::now();
+    Document *doc = tokenizer->tokenizestring( corpus );
+    tok.secs += seconds_since( start );
+    tagger.addDeclaration( *doc );
+    iob.addDeclaration( *doc );
+    ner.addDeclaration( *doc );
+    mblem.addDeclaration( *doc );
+    mbma.addDeclaration( *doc );
+    mwu.addDeclaration( *doc );
+    parser.addDeclaration( *doc );
+    for ( const auto& sent : doc->sentences() ){
+      vector<Word*> words = sent->words();
+      if ( words.empty() ){
+	continue;
+      }
+      ++tok.sentences;
+      tok.tokens += words.size();
+      SentenceRecord rec( words, "current" );
+      for ( auto& mod : modules ){
+	AnnotationBuffer buf;
+	start = chrono::steady_clock::now();
+	mod.run( rec, buf );
+	double secs = seconds_since( start );
+	buf.commit();
+	mod.secs += secs;
+	mod.tokens += words.size();
+	++mod.sentences;
+	mod.samples.push_back( Sample{ words.size(), secs } );
+      }
+    }
+    delete doc;
+  }
+  delete tokenizer;
+  return true;
+}
+
+bool bench_pipeline( const string& corpus, vector<PipelineRun>& runs ){
+  // frog the whole corpus with 1 up to maxThreads workers, to see how
+  // Frog scales
+  for ( int threads=1; threads <= maxThreads; ++threads ){
+    FrogOptions options;
+    options.numWorkers = threads;
+    options.numThreads = 1;
+    auto start = chrono::steady_clock::now();
+    FrogAPI *frog = 0;
+    try {
+      frog = new FrogAPI( options, configuration, theErrLog );
+    }
+    catch ( const exception& e ){
+      cerr << "Frog initialization failed: " << e.what() << endl;
+      return false;
+    }
+    PipelineRun run;
+    run.threads = threads;
+    run.init_secs = seconds_since( start );
+    start = chrono::steady_clock::now();
+    for ( int r=0; r < repeat; ++r ){
+      frog->Frogtostring( corpus );
+    }
+    run.secs = seconds_since( start );
+    runs.push_back( run );
+    delete frog;
+    cerr << "frogged the corpus with " << threads << " thread(s) in "
+	 << run.secs << " seconds" << endl;
+  }
+  return true;
+}
+
+void report( ostream& os,
+	     const BenchModule& tok,
+	     const vector<BenchModule>& modules,
+	     const vector<PipelineRun>& runs ){
+  // everything we measured, as JSON. Times are in seconds
+  os << "{\n  \"version\": " << json_string( VERSION ) << ",\n"
+     << "  \"corpus\": { \"files\": [";
+  for ( size_t i=0; i < fileNames.size(); ++i ){
+    os << ( i > 0 ? ", " : " " ) << json_string( fileNames[i] );
+  }
+  os << " ], \"sentences\": " << tok.sentences / repeat
+     << ", \"tokens\": " << tok.tokens / repeat << " },\n"
+     << "  \"repeat\": " << repeat << ",\n"
+     << "  \"modules\": {\n"
+     << "    " << json_string( tok.name ) << ": { ";
+  write_rates( os, tok.secs, tok.tokens, tok.sentences );
+  os << " }";
+  vector<Sample> totals( tok.sentences );
+  for ( const auto& mod : modules ){
+    os << ",\n    " << json_string( mod.name ) << ": { ";
+    write_rates( os, mod.secs, mod.tokens, mod.sentences );
+    os << ",\n      \"latency\": ";
+    write_latencies( os, mod.samples );
+    os << " }";
+    for ( size_t i=0; i < mod.samples.size(); ++i ){
+      totals[i].length = mod.samples[i].length;
+      totals[i].secs += mod.samples[i].secs;
+    }
+  }
+  double total_secs = 0;
+  for ( const auto& mod : modules ){
+    total_secs += mod.secs;
+  }
+  os << ",\n    \"total\": { ";
+  write_rates( os, total_secs, tok.tokens, tok.sentences );
+  os << ",\n      \"latency\": ";
+  write_latencies( os, totals );
+  os << " }\n  },\n  \"pipeline\": [";
+  for ( size_t i=0; i < runs.size(); ++i ){
+    const PipelineRun& run = runs[i];
+    os << ( i > 0 ? "," : "" ) << "\n    { \"threads\": " << run.threads
+       << ", \"init_seconds\": " << run.init_secs << ", ";
+    write_rates( os, run.secs, tok.tokens, tok.sentences );
+    os << ", \"speedup\": "
+       << ( run.secs > 0 ? runs[0].secs / run.secs : 0 ) << " }";
+  }
+  os << " ],\n  \"peak_rss_bytes\": " << peak_rss_bytes() << "\n}" << endl;
+}
+
+int main(int argc, char *argv[]) {
+  std::ios_base::sync_with_stdio(false);
+  cerr << "frog-bench " << VERSION << " (c) CLTS, ILK 2017" << endl;
+  TiCC::CL_Options Opts("Vt:o:hc:","version,threads:,repeat:");
+  try {
+    Opts.init(argc, argv);
+  }
+  catch ( const exception& e ){
+    cerr << "fatal error: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+  if ( !parse_args(Opts) ){
+    usage();
+    return EXIT_FAILURE;
+  }
+  string corpus;
+  for ( const auto& name : fileNames ){
+    ifstream in( name );
+    if ( !in ){
+      cerr << "unable to open: " << name << endl;
+      return EXIT_FAILURE;
+    }
+    stringstream ss;
+    ss << in.rdbuf();
+    corpus += ss.str() + "\n";
+  }
+#ifdef HAVE_OPENMP
+  omp_set_num_threads( 1 );
+#endif
+  BenchModule tok;
+  vector<BenchModule> modules;
+  vector<PipelineRun> runs;
+  try {
+    if ( !bench_modules( corpus, modules, tok )
+	 || !bench_pipeline( corpus, runs ) ){
+      cerr << "terminated." << endl;
+      return EXIT_FAILURE;
+    }
+  }
+  catch ( const exception& e ){
+    cerr << "benchmark failed: " << e.what() << endl;
+    return EXIT_FAILURE;
+  }
+  if ( outFileName.empty() ){
+    report( cout, tok, modules, runs );
+  }
+  else {
+    ofstream os( outFileName );
+    if ( !os ){
+      cerr << "unable to write: " << outFileName << endl;
+      return EXIT_FAILURE;
+    }
+    report( os, tok, modules, runs );
+  }
+  return EXIT_SUCCESS;
+}
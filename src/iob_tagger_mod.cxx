@@ -143,6 +143,7 @@ void IOBTagger::addChunk( ChunkingLayer *chunks,
 			  const vector<Word*>& words,
 			  const vector<double>& confs,
 			  const string& IOB ){
+  // called from an AnnotationBuffer commit
   double conf = 1;
   for ( auto const& val : confs )
     conf *= val;
@@ -152,51 +153,74 @@ void IOBTagger::addChunk( ChunkingLayer *chunks,
   args["confidence"] = toString(conf);
   args["generate_id"] = chunks->id();
   Chunk *chunk = 0;
-#pragma omp critical(foliaupdate)
-  {
-    try {
-      chunk = new Chunk( args, chunks->doc() );
-      chunks->append( chunk );
-    }
-    catch ( exception& e ){
-      LOG << "addChunk failed: " << e.what() << endl;
-      throw;
-    }
+  try {
+    chunk = new Chunk( args, chunks->doc() );
+    chunks->append( chunk );
+  }
+  catch ( exception& e ){
+    LOG << "addChunk failed: " << e.what() << endl;
+    throw;
   }
   for ( const auto& word : words ){
     if ( word->isinstance(PlaceHolder_t) ){
       continue;
     }
-#pragma omp critical(foliaupdate)
-    {
-      chunk->append( word );
+    chunk->append( word );
+  }
+}
+
+void IOBTagger::addChunks( const vector<Word*>& words,
+			   const vector<vector<Word*>>& stacks,
+			   const vector<vector<double>>& dstacks,
+			   const vector<string>& iobs ){
+  // called from an AnnotationBuffer commit
+  Sentence *sent = words[0]->sentence();
+  ChunkingLayer *el = 0;
+  try {
+    el = sent->annotation<ChunkingLayer>(tagset);
+  }
+  catch(...){
+    KWargs args;
+    args["generate_id"] = sent->id();
+    args["set"] = tagset;
+    el = new ChunkingLayer( args, sent->doc() );
+    sent->append( el );
+  }
+  for ( size_t i=0; i < stacks.size(); ++i ){
+    addChunk( el, stacks[i], dstacks[i], iobs[i] );
+  }
+}
+
+static void record_chunk( SentenceRecord& rec,
+			  const vector<size_t>& positions,
+			  const string& iob ){
+  // the B- and I- tags of the words of a chunk. (PlaceHolders aren't
+  // part of the chunk)
+  bool first = true;
+  for ( const auto& i : positions ){
+    if ( rec.words[i]->isinstance(PlaceHolder_t) ){
+      continue;
     }
+    rec.chunks[i] = ( first ? "B-" : "I-" ) + iob;
+    first = false;
   }
 }
 
-void IOBTagger::addIOBTags( const vector<Word*>& words,
+void IOBTagger::addIOBTags( SentenceRecord& rec,
 			    const vector<string>& tags,
-			    const vector<double>& confs ){
+			    const vector<double>& confs,
+			    AnnotationBuffer& buf ){
+  const vector<Word*>& words = rec.words;
   if ( words.empty() ){
     return;
   }
-  ChunkingLayer *el = 0;
-#pragma omp critical(foliaupdate)
-  {
-    Sentence *sent = words[0]->sentence();
-    try {
-      el = sent->annotation<ChunkingLayer>(tagset);
-    }
-    catch(...){
-      KWargs args;
-      args["generate_id"] = sent->id();
-      args["set"] = tagset;
-      el = new ChunkingLayer( args, sent->doc() );
-      sent->append( el );
-    }
-  }
+  // first collect the chunks, they are added to the FoLiA in one go
+  vector<vector<Word*>> stacks;
+  vector<vector<double>> dstacks;
+  vector<string> iobs;
   vector<Word*> stack;
   vector<double> dstack;
+  vector<size_t> positions;
   string curIOB;
   for ( size_t i=0; i < tags.size(); ++i ){
     if (debug){
@@ -219,9 +243,13 @@ void IOBTagger::addIOBTags( const vector<Word*>& words,
 	  using TiCC::operator<<;
 	  LOG << "spit out " << stack << endl;
 	}
-	addChunk( el, stack, dstack, curIOB );
+	stacks.push_back( stack );
+	dstacks.push_back( dstack );
+	iobs.push_back( curIOB );
+	record_chunk( rec, positions, curIOB );
 	dstack.clear();
 	stack.clear();
+	positions.clear();
       }
       continue;
     }
@@ -243,14 +271,19 @@ void IOBTagger::addIOBTags( const vector<Word*>& words,
 	  using TiCC::operator<<;
 	  LOG << "spit out " << stack << endl;
 	}
-	addChunk( el, stack, dstack, curIOB );
+	stacks.push_back( stack );
+	dstacks.push_back( dstack );
+	iobs.push_back( curIOB );
+	record_chunk( rec, positions, curIOB );
 	dstack.clear();
 	stack.clear();
+	positions.clear();
       }
       curIOB = iob[1];
     }
     dstack.push_back( confs[i] );
     stack.push_back( words[i] );
+    positions.push_back( i );
   }
   if ( !stack.empty() ){
     if ( debug ){
@@ -258,8 +291,13 @@ void IOBTagger::addIOBTags( const vector<Word*>& words,
       using TiCC::operator<<;
       LOG << "spit out " << stack << endl;
     }
-    addChunk( el, stack, dstack, curIOB );
+    stacks.push_back( stack );
+    dstacks.push_back( dstack );
+    iobs.push_back( curIOB );
+    record_chunk( rec, positions, curIOB );
   }
+  buf.add( [this,words,stacks,dstacks,iobs](){
+      addChunks( words, stacks, dstacks, iobs ); } );
 }
 
 void IOBTagger::addDeclaration( Document& doc ) const {
@@ -272,19 +310,17 @@ void IOBTagger::addDeclaration( Document& doc ) const {
   }
 }
 
-void IOBTagger::Classify( const vector<Word *>& swords ){
+void IOBTagger::Classify( SentenceRecord& rec,
+			  AnnotationBuffer& buf ){
+  const vector<Word *>& swords = rec.words;
   if ( !swords.empty() ) {
     string sentence; // the tagger needs the whole sentence
-    for ( const auto& sword : swords ){
-      UnicodeString word;
-#pragma omp critical(foliaupdate)
-      {
-	word = sword->text( textclass );
-      }
+    for ( size_t i=0; i < rec.size(); ++i ){
+      UnicodeString word = rec.text[i];
       if ( filter )
 	word = filter->filter( word );
       sentence += UnicodeToUTF8(word);
-      if ( &sword != &swords.back() ){
+      if ( i < rec.size()-1 ){
 	sentence += " ";
       }
     }
@@ -309,7 +345,7 @@ void IOBTagger::Classify( const vector<Word *>& swords ){
       tags.push_back( tag.assignedTag() );
       conf.push_back( tag.confidence() );
     }
-    addIOBTags( swords, tags, conf );
+    addIOBTags( rec, tags, conf, buf );
   }
 }
 
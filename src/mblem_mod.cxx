@@ -33,6 +33,11 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
+#include "config.h"
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
 #include "timbl/TimblAPI.h"
 #include "ucto/unicode.h"
 #include "ticcutils/LogStream.h"
@@ -169,6 +174,14 @@ bool Mblem::init( const Configuration& config ) {
   return myLex->GetInstanceBase(treeName);
 }
 
+MblemContext::MblemContext( const Mblem& mblem ){
+  myLex = new Timbl::TimblAPI( *mblem.myLex );
+}
+
+MblemContext::~MblemContext(){
+  delete myLex;
+}
+
 Mblem::~Mblem(){
   //    LOG << "cleaning up MBLEM stuff" << endl;
   delete filter;
@@ -177,7 +190,7 @@ Mblem::~Mblem(){
   delete mblemLog;
 }
 
-string Mblem::make_instance( const UnicodeString& in ) {
+string Mblem::make_instance( const UnicodeString& in ) const {
   if (debug) {
     LOG << "making instance from: " << in << endl;
   }
@@ -201,23 +214,29 @@ string Mblem::make_instance( const UnicodeString& in ) {
   return result;
 }
 
-void Mblem::addLemma( Word *word, const string& cls ){
+void Mblem::addLemma( SentenceRecord& rec, size_t i, const string& cls,
+		      AnnotationBuffer& buf ) const {
+  // add a lemma to word i. The record only keeps the first one
+  if ( rec.lemmas[i].empty() ){
+    rec.lemmas[i] = cls;
+  }
+  Word *word = rec.words[i];
   KWargs args;
   args["set"]=tagset;
   args["class"]=cls;
-#pragma omp critical(foliaupdate)
-  {
-    try {
-      word->addLemmaAnnotation( args );
-    }
-    catch( const exception& e ){
-      LOG << e.what() << " addLemma failed." << endl;
-      throw;
-    }
-  }
+  buf.add( [this,word,args](){
+      try {
+	word->addLemmaAnnotation( args );
+      }
+      catch( const exception& e ){
+	LOG << e.what() << " addLemma failed." << endl;
+	throw;
+      }
+    } );
 }
 
-void Mblem::filterTag( const string& postag ){
+void Mblem::filterTag( const string& postag, MblemContext& ctx ) const {
+  vector<mblemData>& mblemResult = ctx.mblemResult;
   auto it = mblemResult.begin();
   while( it != mblemResult.end() ){
     string tag = it->getTag();
@@ -241,7 +260,8 @@ void Mblem::filterTag( const string& postag ){
   }
 }
 
-void Mblem::makeUnique( ){
+void Mblem::makeUnique( MblemContext& ctx ) const {
+  vector<mblemData>& mblemResult = ctx.mblemResult;
   auto it = mblemResult.begin();
   while( it != mblemResult.end() ){
     string lemma = it->getLemma();
@@ -274,16 +294,20 @@ void Mblem::makeUnique( ){
   }
 }
 
-void Mblem::getFoLiAResult( Word *word, const UnicodeString& uWord ){
+void Mblem::getFoLiAResult( SentenceRecord& rec, size_t i,
+			    const UnicodeString& uWord,
+			    const MblemContext& ctx,
+			    AnnotationBuffer& buf ) const {
+  const vector<mblemData>& mblemResult = ctx.mblemResult;
   if ( mblemResult.empty() ){
     // just return the word as a lemma
     string result = UnicodeToUTF8( uWord );
-    addLemma( word, result );
+    addLemma( rec, i, result, buf );
   }
   else {
     for ( auto const& it : mblemResult ){
       string result = it.getLemma();
-      addLemma( word, result );
+      addLemma( rec, i, result, buf );
     }
   }
 }
@@ -299,18 +323,15 @@ void Mblem::addDeclaration( Document& doc ) const {
   }
 }
 
-void Mblem::Classify( Word *sword ){
+void Mblem::Classify( SentenceRecord& rec, size_t i,
+		      MblemContext& ctx,
+		      AnnotationBuffer& buf ) const {
+  Word *sword = rec.words[i];
   if ( sword->isinstance(PlaceHolder_t ) )
     return;
-  UnicodeString uword;
-  string pos;
-  string token_class;
-#pragma omp critical(foliaupdate)
-  {
-    uword = sword->text( textclass );
-    pos = sword->pos();
-    token_class = sword->cls();
-  }
+  UnicodeString uword = rec.text[i];
+  const string& pos = rec.tags[i];
+  const string& token_class = rec.token_class[i];
   if (debug){
     LOG << "Classify " << uword << "(" << pos << ") ["
 	<< token_class << "]" << endl;
@@ -321,7 +342,7 @@ void Mblem::Classify( Word *sword ){
   if ( token_class == "ABBREVIATION" ){
     // We dont handle ABBREVIATION's so just take the word as such
     string word = UnicodeToUTF8(uword);
-    addLemma( sword, word );
+    addLemma( rec, i, word, buf );
     return;
   }
   auto const& it1 = token_strip_map.find( pos );
@@ -332,30 +353,74 @@ void Mblem::Classify( Word *sword ){
     if ( it2 != it1->second.end() ){
       uword = UnicodeString( uword, 0, uword.length() - it2->second );
       string word = UnicodeToUTF8(uword);
-      addLemma( sword, word );
+      addLemma( rec, i, word, buf );
       return;
     }
   }
   if ( one_one_tags.find(pos) != one_one_tags.end() ){
     // some tags are just taken as such
     string word = UnicodeToUTF8(uword);
-    addLemma( sword, word );
+    addLemma( rec, i, word, buf );
     return;
   }
   if ( !keep_case ){
     uword.toLower();
   }
-  Classify( uword );
-  filterTag( pos );
-  makeUnique();
-  getFoLiAResult( sword, uword );
+  Classify( uword, ctx );
+  filterTag( pos, ctx );
+  makeUnique( ctx );
+  getFoLiAResult( rec, i, uword, ctx, buf );
+}
+
+void Mblem::Classify( SentenceRecord& rec, MblemContext& ctx,
+		      AnnotationBuffer& buf ) const {
+  // handle a whole sentence in one go
+  for ( size_t i=0; i < rec.size(); ++i ){
+    Classify( rec, i, ctx, buf );
+  }
+}
+
+void Mblem::Classify( SentenceRecord& rec,
+		      const vector<MblemContext*>& ctxs,
+		      AnnotationBuffer& buf ) const {
+  // handle a whole sentence, with the words split over as many threads as
+  // we got contexts. See Mbma::Classify()
+  size_t num = ctxs.size();
+  if ( num < 2 || rec.size() < 2 ){
+    Classify( rec, *ctxs.front(), buf );
+    return;
+  }
+  vector<AnnotationBuffer> bufs( rec.size() );
+  string exs;
+#pragma omp parallel for schedule(dynamic) num_threads(num)
+  for ( size_t i=0; i < rec.size(); ++i ){
+#ifdef HAVE_OPENMP
+    MblemContext& ctx = *ctxs[omp_get_thread_num()];
+#else
+    MblemContext& ctx = *ctxs[0];
+#endif
+    try {
+      Classify( rec, i, ctx, bufs[i] );
+    }
+    catch ( exception& e ){
+#pragma omp critical(mblem_errors)
+      exs += string(e.what()) + " ";
+    }
+  }
+  if ( !exs.empty() ){
+    throw runtime_error( exs );
+  }
+  for ( const auto& b : bufs ){
+    buf.append( b );
+  }
 }
 
-void Mblem::Classify( const UnicodeString& uWord ){
+void Mblem::Classify( const UnicodeString& uWord, MblemContext& ctx ) const {
+  vector<mblemData>& mblemResult = ctx.mblemResult;
   mblemResult.clear();
   string inst = make_instance(uWord);
   string classString;
-  myLex->Classify( inst, classString );
+  ctx.myLex->Classify( inst, classString );
   if (debug){
     LOG << "class: " << classString  << endl;
   }
@@ -498,9 +563,9 @@ void Mblem::Classify( const UnicodeString& uWord ){
   }
 }
 
-vector<pair<string,string> > Mblem::getResult() const {
+vector<pair<string,string> > Mblem::getResult( const MblemContext& ctx ) const {
   vector<pair<string,string> > result;
-  for ( const auto& mbr : mblemResult ){
+  for ( const auto& mbr : ctx.mblemResult ){
     result.push_back( make_pair( mbr.getLemma(),
 				 mbr.getTag() ) );
   }
@@ -155,6 +155,7 @@ bool init(){
 }
 
 void Test( istream& in ){
+  MblemContext ctx( myMblem );
   string line;
   while ( getline( in, line ) ){
     vector<string> sentences;
@@ -169,9 +170,9 @@ void Test( istream& in ){
 	vector<TagResult> tagrv = tagger.tagLine( s );
 	for ( const auto& tr : tagrv ){
 	  UnicodeString uWord = folia::UTF8ToUnicode(tr.word());
-	  myMblem.Classify( uWord );
-	  myMblem.filterTag( tr.assignedTag() );
-	  vector<pair<string,string> > res = myMblem.getResult();
+	  myMblem.Classify( uWord, ctx );
+	  myMblem.filterTag( tr.assignedTag(), ctx );
+	  vector<pair<string,string> > res = myMblem.getResult( ctx );
 	  string line = tr.word() + " {" + tr.assignedTag() + "}\t";
 	  for ( const auto& p : res ){
 	    line += p.first + "[" + p.second + "]/";
@@ -185,8 +186,8 @@ void Test( istream& in ){
 	TiCC::split( s, parts );
 	for ( const auto& w : parts ){
 	  UnicodeString uWord = folia::UTF8ToUnicode(w);
-	  myMblem.Classify( uWord );
-	  vector<pair<string,string> > res = myMblem.getResult();
+	  myMblem.Classify( uWord, ctx );
+	  vector<pair<string,string> > res = myMblem.getResult( ctx );
 	  string line = w + "\t";
 	  for ( const auto& p : res ){
 	    line += p.first + "[" + p.second + "]/";
@@ -700,10 +700,7 @@ Morpheme *BracketLeaf::createMorpheme( Document *doc,
     args["set"] = Mbma::mbma_tagset;
     args["class"] = "stem";
     result = new Morpheme( args, doc );
-#pragma omp critical(foliaupdate)
-    {
-      result->settext( out );
-    }
+    result->settext( out );
     ++cnt;
     args.clear();
     args["set"] = Mbma::clex_tagset;
@@ -718,10 +715,7 @@ Morpheme *BracketLeaf::createMorpheme( Document *doc,
       args["class"] = toString( tag() );
       desc = "[" + out + "]" + CLEX::get_tDescr( tag() ); // spread the word upwards!
     }
-#pragma omp critical(foliaupdate)
-    {
-      result->addPosAnnotation( args );
-    }
+    result->addPosAnnotation( args );
   }
   else if ( _status == Status::PARTICLE ){
     string out = UnicodeToUTF8(morph);
@@ -732,18 +726,12 @@ Morpheme *BracketLeaf::createMorpheme( Document *doc,
     args["set"] = Mbma::mbma_tagset;
     args["class"] = "particle";
     result = new Morpheme( args, doc );
-#pragma omp critical(foliaupdate)
-    {
-      result->settext( out );
-    }
+    result->settext( out );
     ++cnt;
     args.clear();
     args["set"] = Mbma::clex_tagset;
     args["class"] = toString( tag() );
-#pragma omp critical(foliaupdate)
-    {
-      result->addPosAnnotation( args );
-    }
+    result->addPosAnnotation( args );
     desc = "[" + out + "]"; // spread the word upwards! maybe add 'part' ??
   }
   else if ( _status == Status::INFLECTION ){
@@ -761,10 +749,7 @@ Morpheme *BracketLeaf::createMorpheme( Document *doc,
     args["class"] = "inflection";
     args["set"] = Mbma::mbma_tagset;
     result = new Morpheme( args, doc );
-#pragma omp critical(foliaupdate)
-    {
-      result->settext( out );
-    }
+    result->settext( out );
     ++cnt;
     args.clear();
     args["subset"] = "inflection";
@@ -776,10 +761,7 @@ Morpheme *BracketLeaf::createMorpheme( Document *doc,
 	  args["class"] = d;
 	  desc += "/" + d;
 	  folia::Feature *feat = new folia::Feature( args );
-#pragma omp critical(foliaupdate)
-	  {
-	    result->append( feat );
-	  }
+	  result->append( feat );
 	}
       }
     }
@@ -803,10 +785,7 @@ Morpheme *BracketLeaf::createMorpheme( Document *doc,
     }
     args["set"] = Mbma::mbma_tagset;
     result = new Morpheme( args, doc );
-#pragma omp critical(foliaupdate)
-    {
-      result->settext( out );
-    }
+    result->settext( out );
     ++cnt;
     desc = "[" + out + "]"; // pass it up!
     for ( const auto& inf : inflect ){
@@ -821,11 +800,8 @@ Morpheme *BracketLeaf::createMorpheme( Document *doc,
     args.clear();
     args["subset"] = "structure";
     args["class"]  = desc;
-#pragma omp critical(foliaupdate)
-    {
-      folia::Feature *feat = new folia::Feature( args );
-      result->append( feat );
-    }
+    folia::Feature *feat = new folia::Feature( args );
+    result->append( feat );
     args.clear();
 //     args["set"] = Mbma::clex_tagset;
 //     args["class"] = orig;
@@ -849,10 +825,7 @@ Morpheme *BracketLeaf::createMorpheme( Document *doc,
 	  desc += "/" + d;
 	  args["class"] = d;
 	  folia::Feature *feat = new folia::Feature( args );
-#pragma omp critical(foliaupdate)
-	  {
-	    result->append( feat );
-	  }
+	  result->append( feat );
 	}
       }
     }
@@ -888,11 +861,8 @@ Morpheme *BracketNest::createMorpheme( Document *doc,
 	args.clear();
 	args["subset"] = "applied_rule";
 	args["class"] = it->original();
-#pragma omp critical(foliaupdate)
-	{
-	  folia::Feature *feat = new folia::Feature( args );
-	  result->append( feat );
-	}
+	folia::Feature *feat = new folia::Feature( args );
+	result->append( feat );
       }
     }
     if ( m ){
@@ -908,31 +878,21 @@ Morpheme *BracketNest::createMorpheme( Document *doc,
   args.clear();
   args["subset"] = "structure";
   args["class"]  = desc;
-#pragma omp critical(foliaupdate)
-  {
-    folia::Feature *feat = new folia::Feature( args );
-    result->append( feat );
-  }
+  folia::Feature *feat = new folia::Feature( args );
+  result->append( feat );
   args.clear();
   args["set"] = Mbma::clex_tagset;
   args["class"] = toString( tag() );
   PosAnnotation *pos = 0;
-#pragma omp critical(foliaupdate)
-  {
-    pos = result->addPosAnnotation( args );
-  }
+  pos = result->addPosAnnotation( args );
   Compound::Type ct = compound();
   if ( ct != Compound::Type::NONE ){
     args.clear();
     args["subset"] = "compound";
     args["class"]  = toString(ct);
-#pragma omp critical(foliaupdate)
-    {
-      folia::Feature *feat = new folia::Feature( args );
-      pos->append( feat );
-    }
+    folia::Feature *feat = new folia::Feature( args );
+    pos->append( feat );
   }
-#pragma omp critical(foliaupdate)
   for ( const auto& s : stack ){
     result->append( s );
   }
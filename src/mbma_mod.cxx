@@ -36,6 +36,12 @@
 #include <algorithm>
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
+#include <memory>
+#include "config.h"
+#ifdef HAVE_OPENMP
+#include <omp.h>
+#endif
 #include "timbl/TimblAPI.h"
 
 #include "ucto/unicode.h"
@@ -219,10 +225,25 @@ void Mbma::cleanUp(){
   // LOG << "cleaning up MBMA stuff " << endl;
   delete MTree;
   MTree = 0;
+}
+
+MbmaContext::MbmaContext( const Mbma& mbma ):
+  deep( mbma.doDeepMorph ),
+  transliterator(0)
+{
+  MTree = new Timbl::TimblAPI( *mbma.MTree );
+  if ( mbma.transliterator ){
+    transliterator = mbma.transliterator->clone();
+  }
+}
+
+MbmaContext::~MbmaContext(){
   clearAnalysis();
+  delete MTree;
+  delete transliterator;
 }
 
-vector<string> Mbma::make_instances( const UnicodeString& word ){
+vector<string> Mbma::make_instances( const UnicodeString& word ) const {
   vector<string> insts;
   insts.reserve( word.length() );
   for ( long i=0; i < word.length(); ++i ) {
@@ -309,7 +330,7 @@ vector<vector<string> > generate_all_perms( const vector<string>& classes ){
   return result;
 }
 
-void Mbma::clearAnalysis(){
+void MbmaContext::clearAnalysis(){
   for ( const auto& a: analysis ){
     delete a;
   }
@@ -317,7 +338,8 @@ void Mbma::clearAnalysis(){
 }
 
 Rule* Mbma::matchRule( const std::vector<std::string>& ana,
-		       const UnicodeString& word ){
+		       const UnicodeString& word,
+		       bool deep ) const {
   Rule *rule = new Rule( ana, word, *mbmaLog, debugFlag );
   if ( rule->performEdits() ){
     rule->reduceZeroNodes();
@@ -325,14 +347,14 @@ Rule* Mbma::matchRule( const std::vector<std::string>& ana,
       LOG << "after reduction: " << rule << endl;
     }
 #ifdef EXPERIMENT
-    rule->resolveBrackets( doDeepMorph );
+    rule->resolveBrackets( deep );
 #endif
     rule->resolve_inflections();
     if ( debugFlag ){
       LOG << "after resolving: " << rule << endl;
     }
 #ifndef EXPERIMENT
-    rule->resolveBrackets( doDeepMorph );
+    rule->resolveBrackets( deep );
 #endif
     rule->getCleanInflect();
     if ( debugFlag ){
@@ -350,7 +372,8 @@ Rule* Mbma::matchRule( const std::vector<std::string>& ana,
 }
 
 vector<Rule*> Mbma::execute( const UnicodeString& word,
-			     const vector<string>& classes ){
+			     const vector<string>& classes,
+			     bool deep ) const {
   vector<vector<string> > allParts = generate_all_perms( classes );
   if ( debugFlag ){
     string out = "alternatives: word=" + UnicodeToUTF8(word) + ", classes=<";
@@ -365,7 +388,7 @@ vector<Rule*> Mbma::execute( const UnicodeString& word,
   vector<Rule*> accepted;
   // now loop over all the analysis
   for ( auto const& ana : allParts ){
-    Rule *rule = matchRule( ana, word );
+    Rule *rule = matchRule( ana, word, deep );
     if ( rule ){
       accepted.push_back( rule );
     }
@@ -373,27 +396,43 @@ vector<Rule*> Mbma::execute( const UnicodeString& word,
   return accepted;
 }
 
-void Mbma::addMorph( Word *word,
-		     const vector<string>& morphs ) const {
-  KWargs args;
-  args["set"] = mbma_tagset;
-  MorphologyLayer *ml;
-#pragma omp critical(foliaupdate)
-  {
-    try {
-      ml = word->addMorphologyLayer( args );
-    }
-    catch( const exception& e ){
-      LOG << e.what() << " addMorph failed." << endl;
-      throw;
-    }
-  }
-  addMorph( ml, morphs );
+void Mbma::addMorph( SentenceRecord& rec, size_t i,
+		     const vector<string>& morphs,
+		     AnnotationBuffer& buf ) const {
+  // add a MorphologyLayer with the morphemes to word i. The record gets
+  // them as one bracketed string
+  string flat;
+  for ( const auto& mor : morphs ){
+    flat += "[" + mor + "]";
+  }
+  rec.morphs[i].push_back( flat );
+  if ( morphs.size() == 1 ){
+    // get_compound_analysis() takes a layer with one Morpheme as a
+    // (non) compound, so the record does too
+    rec.compounds[i].push_back( "" );
+  }
+  Word *word = rec.words[i];
+  buf.add( [this,word,morphs](){
+      KWargs args;
+      args["set"] = mbma_tagset;
+      MorphologyLayer *ml;
+      try {
+	ml = word->addMorphologyLayer( args );
+      }
+      catch( const exception& e ){
+	LOG << e.what() << " addMorph failed." << endl;
+	throw;
+      }
+      addMorph( ml, morphs );
+    } );
 }
 
-void Mbma::addBracketMorph( Word *word,
+void Mbma::addBracketMorph( SentenceRecord& rec, size_t i,
 			    const string& wrd,
-			    const string& tag ) const {
+			    const string& tag,
+			    const string& tagger_head,
+			    AnnotationBuffer& buf ) const {
+  Word *word = rec.words[i];
   if (debugFlag){
     LOG << "addBracketMorph(" << wrd << "," << tag << ")" << endl;
   }
@@ -404,11 +443,7 @@ void Mbma::addBracketMorph( Word *word,
   }
   else if ( head == "X" ) {
     // unanalysed, so trust the TAGGER
-#pragma omp critical(foliaupdate)
-    {
-      const auto pos = word->annotation<PosAnnotation>( cgn_tagset );
-      head = pos->feat("head");
-    }
+    head = tagger_head;
     if (debugFlag){
       LOG << "head was X, tagger gives :" << head << endl;
     }
@@ -423,94 +458,99 @@ void Mbma::addBracketMorph( Word *word,
       LOG << "replaced X by: " << head << endl;
     }
   }
-
+  // the Morpheme isn't part of the document yet, so it can be build here
   KWargs args;
   args["set"] = mbma_tagset;
-  MorphologyLayer *ml;
-#pragma omp critical(foliaupdate)
-  {
-    try {
-      ml = word->addMorphologyLayer( args );
-    }
-    catch( const exception& e ){
-      LOG << e.what() << " addBracketMorph failed." << endl;
-      throw;
-    }
-  }
   args["class"] = "stem";
-  Morpheme *result = new Morpheme( args, word->doc() );
-#pragma omp critical(foliaupdate)
-  {
-    result->settext( wrd, textclass );
-  }
+  unique_ptr<Morpheme> result( new Morpheme( args, word->doc() ) );
+  result->settext( wrd, textclass );
   args.clear();
   args["subset"] = "structure";
   args["class"]  = "[" + wrd + "]" + head;
-#pragma omp critical(foliaupdate)
-  {
-    folia::Feature *feat = new folia::Feature( args );
-    result->append( feat );
-  }
+  folia::Feature *feat = new folia::Feature( args );
+  result->append( feat );
   args.clear();
   args["set"] = clex_tagset;
   args["class"] = celex_tag;
-#pragma omp critical(foliaupdate)
-  {
-    result->addPosAnnotation( args );
-  }
-#pragma omp critical(foliaupdate)
-  {
-    ml->append( result );
-  }
+  result->addPosAnnotation( args );
+  addMorpheme( rec, i, result.release(), buf );
 }
 
-void Mbma::addBracketMorph( Word *word,
+void Mbma::addBracketMorph( SentenceRecord& rec, size_t i,
 			    const string& orig_word,
-			    const BracketNest *brackets ) const {
+			    const BracketNest *brackets,
+			    AnnotationBuffer& buf ) const {
+  Word *word = rec.words[i];
   if (debugFlag){
     LOG << "addBracketMorph(" << word << "," << orig_word << "," << brackets << ")" << endl;
   }
-  KWargs args;
-  args["set"] = mbma_tagset;
-  MorphologyLayer *ml;
-#pragma omp critical(foliaupdate)
-  {
-    try {
-      ml = word->addMorphologyLayer( args );
-    }
-    catch( const exception& e ){
-      LOG << e.what() << " addBracketMorph failed." << endl;
-      throw;
-    }
-  }
-  Morpheme *m = 0;
+  unique_ptr<Morpheme> m;
   try {
-    m = brackets->createMorpheme( word->doc() );
+    m.reset( brackets->createMorpheme( word->doc() ) );
   }
   catch( const exception& e ){
     cerr << "createMorpheme failed: " << e.what() << endl;
     throw;
   }
   if ( m ){
-#pragma omp critical(foliaupdate)
-    {
-      m->settext( orig_word, textclass );
-      ml->append( m );
+    m->settext( orig_word, textclass );
+  }
+  addMorpheme( rec, i, m.release(), buf );
+}
+
+void Mbma::addMorpheme( SentenceRecord& rec, size_t i,
+			Morpheme *m,
+			AnnotationBuffer& buf ) const {
+  // add a new MorphologyLayer to word i, holding Morpheme m (when not 0).
+  // The record gets the structure and compound type of m. m isn't part
+  // of the document yet, so we may read it here.
+  // We own m until the commit appends it. The buffer may copy the update
+  // (see AnnotationBuffer::append) or drop it without a commit, so m is
+  // shared by the copies, and freed when none of them appended it
+  shared_ptr<unique_ptr<Morpheme>> pending
+    = make_shared<unique_ptr<Morpheme>>( m );
+  if ( m ){
+    rec.morphs[i].push_back( m->feat( "structure" ) );
+    string compound;
+    try {
+      PosAnnotation *pos = m->annotation<PosAnnotation>( clex_tagset );
+      compound = pos->feat( "compound" );
+    }
+    catch (...){
     }
+    rec.compounds[i].push_back( compound );
   }
+  else {
+    rec.morphs[i].push_back( "" );
+  }
+  Word *word = rec.words[i];
+  buf.add( [this,word,pending](){
+      KWargs args;
+      args["set"] = mbma_tagset;
+      MorphologyLayer *ml;
+      try {
+	ml = word->addMorphologyLayer( args );
+      }
+      catch( const exception& e ){
+	LOG << e.what() << " addBracketMorph failed." << endl;
+	throw;
+      }
+      if ( *pending ){
+	ml->append( pending->get() );
+	pending->release();
+      }
+    } );
 }
 
 void Mbma::addMorph( MorphologyLayer *ml,
 		     const vector<string>& morphs ) const {
+  // called from an AnnotationBuffer commit
   for ( const auto& mor : morphs ){
     KWargs args;
     args["set"] = mbma_tagset;
     Morpheme *m = new Morpheme( args, ml->doc() );
-#pragma omp critical(foliaupdate)
-    {
-      m->settext( mor, textclass );
-      ml->append( m );
-    }
+    m->settext( mor, textclass );
+    ml->append( m );
   }
 }
 
@@ -518,7 +558,8 @@ bool mbmacmp( Rule *m1, Rule *m2 ){
   return m1->getKey(false).length() > m2->getKey(false).length();
 }
 
-void Mbma::filterHeadTag( const string& head ){
+void Mbma::filterHeadTag( const string& head, MbmaContext& ctx ) const {
+  vector<Rule*>& analysis = ctx.analysis;
   // first we select only the matching heads
   if (debugFlag){
     LOG << "filter with head: " << head << endl;
@@ -591,7 +632,9 @@ void Mbma::filterHeadTag( const string& head ){
   }
 }
 
-void Mbma::filterSubTags( const vector<string>& feats ){
+void Mbma::filterSubTags( const vector<string>& feats,
+			  MbmaContext& ctx ) const {
+  vector<Rule*>& analysis = ctx.analysis;
   if ( analysis.size() < 1 ){
     if (debugFlag ){
       LOG << "analysis is empty so skip next filter" << endl;
@@ -682,7 +725,7 @@ void Mbma::filterSubTags( const vector<string>& feats ){
   //
   map<UnicodeString, Rule*> unique;
   for ( const auto& ait : highConf ){
-    UnicodeString tmp = ait->getKey( doDeepMorph );
+    UnicodeString tmp = ait->getKey( ctx.deep );
     unique[tmp] = ait;
   }
   // so now we have map of 'equal' analysis.
@@ -728,35 +771,40 @@ void Mbma::filterSubTags( const vector<string>& feats ){
   return;
 }
 
-void Mbma::assign_compounds(){
-  for ( auto const& sit : analysis ){
+void Mbma::assign_compounds( MbmaContext& ctx ) const {
+  for ( auto const& sit : ctx.analysis ){
     sit->compound = sit->brackets->getCompoundType();
   }
 }
 
-void Mbma::getFoLiAResult( Word *fword, const UnicodeString& uword ) const {
+void Mbma::getFoLiAResult( SentenceRecord& rec, size_t i,
+			   const string& head,
+			   const UnicodeString& uword,
+			   const MbmaContext& ctx,
+			   AnnotationBuffer& buf ) const {
+  const vector<Rule*>& analysis = ctx.analysis;
   if ( analysis.size() == 0 ){
     // fallback option: use the word and pretend it's a morpheme ;-)
     if ( debugFlag ){
       LOG << "no matches found, use the word instead: "
 		    << uword << endl;
     }
-    if ( doDeepMorph ){
-      addBracketMorph( fword, UnicodeToUTF8(uword), "X" );
+    if ( ctx.deep ){
+      addBracketMorph( rec, i, UnicodeToUTF8(uword), "X", head, buf );
     }
     else {
       vector<string> tmp;
       tmp.push_back( UnicodeToUTF8(uword) );
-      addMorph( fword, tmp );
+      addMorph( rec, i, tmp, buf );
     }
   }
   else {
     for ( auto const& sit : analysis ){
-      if ( doDeepMorph ){
-	addBracketMorph( fword, UnicodeToUTF8(uword), sit->brackets );
+      if ( ctx.deep ){
+	addBracketMorph( rec, i, UnicodeToUTF8(uword), sit->brackets, buf );
       }
       else {
-	addMorph( fword, sit->extract_morphemes() );
+	addMorph( rec, i, sit->extract_morphemes(), buf );
       }
     }
   }
@@ -776,10 +824,11 @@ void Mbma::addDeclaration( Document& doc ) const {
   }
 }
 
-UnicodeString Mbma::filterDiacritics( const UnicodeString& in ) const {
-  if ( transliterator ){
+UnicodeString Mbma::filterDiacritics( const UnicodeString& in,
+				      const MbmaContext& ctx ) const {
+  if ( ctx.transliterator ){
     UnicodeString result = in;
-    transliterator->transliterate( result );
+    ctx.transliterator->transliterate( result );
     return result;
   }
   else {
@@ -787,23 +836,18 @@ UnicodeString Mbma::filterDiacritics( const UnicodeString& in ) const {
   }
 }
 
-void Mbma::Classify( Word* sword ){
+void Mbma::Classify( SentenceRecord& rec, size_t i,
+		     MbmaContext& ctx,
+		     AnnotationBuffer& buf ) const {
+  Word *sword = rec.words[i];
   if ( sword->isinstance(PlaceHolder_t) ){
     return;
   }
-  UnicodeString uWord;
-  PosAnnotation *pos;
-  string head;
-  string token_class;
-#pragma omp critical(foliaupdate)
-  {
-    uWord = sword->text( textclass );
-    pos = sword->annotation<PosAnnotation>( cgn_tagset );
-    head = pos->feat("head");
-    token_class = sword->cls();
-  }
+  UnicodeString uWord = rec.text[i];
+  const string& head = rec.heads[i];
+  const string& token_class = rec.token_class[i];
   if (debugFlag ){
-    LOG << "Classify " << uWord << "(" << pos << ") ["
+    LOG << "Classify " << uWord << "(" << rec.tags[i] << ") ["
 		  << token_class << "]" << endl;
   }
   if ( filter ){
@@ -813,13 +857,13 @@ void Mbma::Classify( Word* sword ){
     // take over the letter/word 'as-is'.
     //  also ABBREVIATION's aren't handled bij mbma-rules
     string word = UnicodeToUTF8( uWord );
-    if ( doDeepMorph ){
-      addBracketMorph( sword, word, head );
+    if ( ctx.deep ){
+      addBracketMorph( rec, i, word, head, head, buf );
     }
     else {
       vector<string> tmp;
       tmp.push_back( word );
-      addMorph( sword, tmp );
+      addMorph( rec, i, tmp, buf );
     }
   }
   else {
@@ -827,35 +871,82 @@ void Mbma::Classify( Word* sword ){
     if ( head != "SPEC" ){
       lWord.toLower();
     }
-    Classify( lWord );
-    vector<string> featVals;
-#pragma omp critical(foliaupdate)
-    {
-      vector<folia::Feature*> feats = pos->select<folia::Feature>();
-      featVals.reserve( feats.size() );
-      for ( const auto& feat : feats )
-	featVals.push_back( feat->cls() );
+    Classify( lWord, ctx );
+    filterHeadTag( head, ctx );
+    filterSubTags( rec.features[i], ctx );
+    assign_compounds( ctx );
+    getFoLiAResult( rec, i, head, lWord, ctx, buf );
+  }
+}
+
+void Mbma::Classify( SentenceRecord& rec, MbmaContext& ctx,
+		     AnnotationBuffer& buf ) const {
+  Classify( rec, ctx, buf, doDeepMorph );
+}
+
+void Mbma::Classify( SentenceRecord& rec, MbmaContext& ctx,
+		     AnnotationBuffer& buf, bool deep ) const {
+  // handle a whole sentence in one go. deep tells if we want deep
+  // morphology for it; when false we give the shallow analysis, also
+  // when the Mbma does deep morphology
+  ctx.deep = deep;
+  for ( size_t i=0; i < rec.size(); ++i ){
+    Classify( rec, i, ctx, buf );
+  }
+}
+
+void Mbma::Classify( SentenceRecord& rec,
+		     const vector<MbmaContext*>& ctxs,
+		     AnnotationBuffer& buf, bool deep ) const {
+  // handle a whole sentence, with the words split over as many threads as
+  // we got contexts. Every word collects its updates in a buffer of its
+  // own, these are added to buf in the order of the words.
+  size_t num = ctxs.size();
+  if ( num < 2 || rec.size() < 2 ){
+    Classify( rec, *ctxs.front(), buf, deep );
+    return;
+  }
+  for ( const auto& ctx : ctxs ){
+    ctx->deep = deep;
+  }
+  vector<AnnotationBuffer> bufs( rec.size() );
+  string exs;
+#pragma omp parallel for schedule(dynamic) num_threads(num)
+  for ( size_t i=0; i < rec.size(); ++i ){
+#ifdef HAVE_OPENMP
+    MbmaContext& ctx = *ctxs[omp_get_thread_num()];
+#else
+    MbmaContext& ctx = *ctxs[0];
+#endif
+    try {
+      Classify( rec, i, ctx, bufs[i] );
+    }
+    catch ( exception& e ){
+#pragma omp critical(mbma_errors)
+      exs += string(e.what()) + " ";
     }
-    filterHeadTag( head );
-    filterSubTags( featVals );
-    assign_compounds();
-    getFoLiAResult( sword, lWord );
+  }
+  if ( !exs.empty() ){
+    throw runtime_error( exs );
+  }
+  for ( const auto& b : bufs ){
+    buf.append( b );
   }
 }
 
-void Mbma::Classify( const UnicodeString& word ){
-  clearAnalysis();
-  UnicodeString uWord = filterDiacritics( word );
+void Mbma::Classify( const UnicodeString& word, MbmaContext& ctx ) const {
+  ctx.clearAnalysis();
+  UnicodeString uWord = filterDiacritics( word, ctx );
   vector<string> insts = make_instances( uWord );
   vector<string> classes;
   classes.reserve( insts.size() );
   int i = 0;
   for ( auto const& inst : insts ) {
     string ans;
-    MTree->Classify( inst, ans );
+    ctx.MTree->Classify( inst, ans );
     if ( debugFlag ){
       LOG << "itt #" << i+1 << " " << insts[i] << " ==> " << ans
-		    << ", depth=" << MTree->matchDepth() << endl;
+		    << ", depth=" << ctx.MTree->matchDepth() << endl;
       ++i;
     }
     classes.push_back( ans);
@@ -865,13 +956,13 @@ void Mbma::Classify( const UnicodeString& word ){
   if ( classes[0] == "0" ){
     classes[0] = "X";
   }
-  analysis = execute( uWord, classes );
+  ctx.analysis = execute( uWord, classes, ctx.deep );
 }
 
-vector<string> Mbma::getResult() const {
+vector<string> Mbma::getResult( const MbmaContext& ctx ) const {
   vector<string> result;
-  for ( const auto& it : analysis ){
-    string tmp = it->morpheme_string( doDeepMorph );
+  for ( const auto& it : ctx.analysis ){
+    string tmp = it->morpheme_string( ctx.deep );
     result.push_back( tmp );
   }
   if ( debugFlag ){
@@ -880,9 +971,9 @@ vector<string> Mbma::getResult() const {
   return result;
 }
 
-vector<pair<string,string>> Mbma::getResults( ) const {
+vector<pair<string,string>> Mbma::getResults( const MbmaContext& ctx ) const {
   vector<pair<string,string>> result;
-  for ( const auto& it : analysis ){
+  for ( const auto& it : ctx.analysis ){
     string tmp = it->morpheme_string( true );
     string cmp = toString( it->compound );
     result.push_back( make_pair(tmp,cmp) );
@@ -167,6 +167,7 @@ bool init(){
 }
 
 void Test( istream& in ){
+  MbmaContext ctx( myMbma );
   string line;
   while ( getline( in, line ) ){
     line = TiCC::trim( line );
@@ -198,12 +199,12 @@ void Test( istream& in ){
 	  if ( head != "SPEC" ){
 	    uWord.toLower();
 	  }
-	  myMbma.Classify( uWord );
-	  myMbma.filterHeadTag( head );
-	  myMbma.filterSubTags( v );
-	  myMbma.assign_compounds();
+	  myMbma.Classify( uWord, ctx );
+	  myMbma.filterHeadTag( head, ctx );
+	  myMbma.filterSubTags( v, ctx );
+	  myMbma.assign_compounds( ctx );
 	  cout << tr.word() << " {" << tr.assignedTag() << "}\t";
-	  vector<pair<string,string>> res = myMbma.getResults();
+	  vector<pair<string,string>> res = myMbma.getResults( ctx );
 	  if ( res.size() == 0 ){
 	    cout << "[" << uWord << "]";
 	  }
@@ -227,9 +228,9 @@ void Test( istream& in ){
 	for ( auto const& w : parts ){
 	  UnicodeString uWord = folia::UTF8ToUnicode(w);
 	  uWord.toLower();
-	  myMbma.Classify( uWord );
-	  myMbma.assign_compounds();
-	  vector<pair<string,string>> res = myMbma.getResults();
+	  myMbma.Classify( uWord, ctx );
+	  myMbma.assign_compounds( ctx );
+	  vector<pair<string,string>> res = myMbma.getResults( ctx );
 	  string line = w + "\t";
 	  for ( auto const& r : res ){
 	    line += r.first;
@@ -0,0 +1,178 @@
+/* ex: set tabstop=8 expandtab: */
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <unistd.h>
+#include "frog/metrics.h"
+
+using namespace std;
+
+// the upper bounds of the histogram buckets, in seconds
+static const double bounds[] = { 0.0001, 0.00025, 0.0005, 0.001, 0.0025,
+				  0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5,
+				  1, 2.5, 5, 10, 30 };
+static const size_t num_bounds = sizeof(bounds) / sizeof(bounds[0]);
+
+// the modules we keep a histogram for, with the timer that measures them
+static const struct {
+  const char *name;
+  ModuleTimer TimerBlock::*timer;
+} module_timers[] = {
+  { "tok", &TimerBlock::tokTimer },
+  { "tag", &TimerBlock::tagTimer },
+  { "iob", &TimerBlock::iobTimer },
+  { "ner", &TimerBlock::nerTimer },
+  { "mblem", &TimerBlock::mblemTimer },
+  { "mbma", &TimerBlock::mbmaTimer },
+  { "mwu", &TimerBlock::mwuTimer },
+  { "parse", &TimerBlock::parseTimer },
+  { "parse_prepare", &TimerBlock::prepareTimer },
+  { "parse_pairs", &TimerBlock::pairsTimer },
+  { "parse_dir", &TimerBlock::dirTimer },
+  { "parse_rels", &TimerBlock::relsTimer },
+  { "parse_csi", &TimerBlock::csiTimer },
+  { "frog", &TimerBlock::frogTimer }
+};
+static const size_t num_modules = sizeof(module_timers)
+  / sizeof(module_timers[0]);
+
+LatencyHistogram::LatencyHistogram():
+  counts( num_bounds + 1, 0 ),
+  total(0),
+  sum(0)
+{}
+
+void LatencyHistogram::observe( double secs ){
+  size_t i = 0;
+  while ( i < num_bounds && secs > bounds[i] ){
+    ++i;
+  }
+  ++counts[i];
+  ++total;
+  sum += secs;
+}
+
+void LatencyHistogram::write( ostream& os,
+			      const string& name,
+			      const string& labels ) const {
+  // the buckets of Prometheus are cumulative
+  unsigned long long cum = 0;
+  for ( size_t i=0; i < num_bounds; ++i ){
+    cum += counts[i];
+    os << name << "_bucket{" << labels << ",le=\"" << bounds[i] << "\"} "
+       << cum << "\n";
+  }
+  os << name << "_bucket{" << labels << ",le=\"+Inf\"} " << total << "\n";
+  os << name << "_sum{" << labels << "} " << sum << "\n";
+  os << name << "_count{" << labels << "} " << total << "\n";
+}
+
+ServerMetrics::ServerMetrics():
+  last_write( chrono::steady_clock::now() ),
+  requests(0),
+  sentences(0),
+  tokens(0),
+  rejected(0),
+  last_requests(0),
+  last_sentences(0),
+  last_tokens(0),
+  modules( num_modules ),
+  connections(0)
+{}
+
+void ServerMetrics::addRequests( size_t reqs, size_t sents, size_t toks ){
+  lock_guard<mutex> guard( lock );
+  requests += reqs;
+  sentences += sents;
+  tokens += toks;
+}
+
+void ServerMetrics::addTimes( const TimerBlock& timers ){
+  // add the times that the modules took for one request (or batch).
+  // Modules that didn't run are left out
+  lock_guard<mutex> guard( lock );
+  for ( size_t i=0; i < num_modules; ++i ){
+    double secs = (timers.*module_timers[i].timer).secs();
+    if ( secs > 0 ){
+      modules[i].observe( secs );
+    }
+  }
+}
+
+void ServerMetrics::addRejected(){
+  lock_guard<mutex> guard( lock );
+  ++rejected;
+}
+
+static long resident_bytes(){
+  // the resident set size of this process, or -1 when unknown
+  ifstream is( "/proc/self/statm" );
+  long pages = 0;
+  long resident = 0;
+  if ( !( is >> pages >> resident ) ){
+    return -1;
+  }
+  return resident * sysconf( _SC_PAGESIZE );
+}
+
+static void counter( ostream& os, const string& name, const string& help,
+		     unsigned long long value ){
+  os << "# HELP " << name << " " << help << "\n"
+     << "# TYPE " << name << " counter\n"
+     << name << " " << value << "\n";
+}
+
+static void gauge( ostream& os, const string& name, const string& help,
+		   double value ){
+  os << "# HELP " << name << " " << help << "\n"
+     << "# TYPE " << name << " gauge\n"
+     << name << " " << value << "\n";
+}
+
+void ServerMetrics::write( ostream& os, size_t queued ){
+  // write all metrics to os. The rates are over the time since the
+  // previous write
+  lock_guard<mutex> guard( lock );
+  auto now = chrono::steady_clock::now();
+  double period = chrono::duration<double>( now - last_write ).count();
+  if ( period <= 0 ){
+    period = 1;
+  }
+  os.precision( 15 ); // so big gauges (like the RSS) stay exact
+  counter( os, "frog_requests_total", "Requests frogged.", requests );
+  counter( os, "frog_sentences_total", "Sentences frogged.", sentences );
+  counter( os, "frog_tokens_total", "Tokens frogged.", tokens );
+  counter( os, "frog_requests_rejected_total",
+	   "Requests not frogged because their deadline passed.", rejected );
+  gauge( os, "frog_requests_per_second",
+	 "Requests frogged per second, since the previous report.",
+	 (requests - last_requests) / period );
+  gauge( os, "frog_sentences_per_second",
+	 "Sentences frogged per second, since the previous report.",
+	 (sentences - last_sentences) / period );
+  gauge( os, "frog_tokens_per_second",
+	 "Tokens frogged per second, since the previous report.",
+	 (tokens - last_tokens) / period );
+  gauge( os, "frog_queue_depth",
+	 "Requests and connections waiting for a server thread.", queued );
+  gauge( os, "frog_active_connections", "Open client connections.",
+	 connections.load() );
+  long rss = resident_bytes();
+  if ( rss >= 0 ){
+    gauge( os, "frog_resident_memory_bytes", "Resident set size.", rss );
+  }
+  const string hist = "frog_module_duration_seconds";
+  os << "# HELP " << hist
+     << " Time a module took for one request, or for one batch summed over"
+     << " the workers.\n"
+     << "# TYPE " << hist << " histogram\n";
+  for ( size_t i=0; i < num_modules; ++i ){
+    modules[i].write( os, hist,
+		      string("module=\"") + module_timers[i].name + "\"" );
+  }
+  last_write = now;
+  last_requests = requests;
+  last_sentences = sentences;
+  last_tokens = tokens;
+}
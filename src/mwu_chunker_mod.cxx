@@ -49,15 +49,9 @@ using namespace folia;
 
 #define LOG *Log(mwuLog)
 
-mwuAna::mwuAna( Word *fwrd, const string& txt, const string& glue_tag ){
-  spec = false;
+mwuAna::mwuAna( Word *fwrd, const string& txt, bool is_glue ){
   word = txt;
-  string tag;
-#pragma omp critical(foliaupdate)
-  {
-    tag = fwrd->annotation<PosAnnotation>()->cls();
-  }
-  spec = ( tag == glue_tag );
+  spec = is_glue;
   fwords.push_back( fwrd );
 }
 
@@ -66,35 +60,27 @@ void mwuAna::merge( const mwuAna *add ){
   delete add;
 }
 
-EntitiesLayer *mwuAna::addEntity( const std::string& tagset,
-				  Sentence *sent, EntitiesLayer *el ){
-  if ( fwords.size() > 1 ){
+static void addEntities( const string& tagset,
+			 Sentence *sent,
+			 const vector<vector<Word*>>& mwus ){
+  // called from an AnnotationBuffer commit
+  EntitiesLayer *el = 0;
+  for ( const auto& fwords : mwus ){
     if ( el == 0 ){
-#pragma omp critical(foliaupdate)
-      {
-	KWargs args;
-	args["generate_id"] = sent->id();
-	el = new EntitiesLayer( args, sent->doc() );
-	sent->append( el );
-      }
+      KWargs args;
+      args["generate_id"] = sent->id();
+      el = new EntitiesLayer( args, sent->doc() );
+      sent->append( el );
     }
     KWargs args;
     args["set"] = tagset;
     args["generate_id"] = el->id();
-    Entity *e=0;
-#pragma omp critical(foliaupdate)
-    {
-      e = new Entity( args, el->doc() );
-      el->append( e );
-    }
+    Entity *e = new Entity( args, el->doc() );
+    el->append( e );
     for ( const auto& fw : fwords ){
-#pragma omp critical(foliaupdate)
-      {
-	e->append( fw );
-      }
+      e->append( fw );
     }
   }
-  return el;
 }
 
 Mwu::Mwu(LogStream * logstream){
@@ -103,28 +89,16 @@ Mwu::Mwu(LogStream * logstream){
 }
 
 Mwu::~Mwu(){
-  reset();
   delete mwuLog;
   delete filter;
 }
 
-void Mwu::reset(){
-  for ( const auto& it : mWords ){
-    delete it;
-  }
-  mWords.clear();
-}
-
-void Mwu::add( Word *word ){
-  UnicodeString tmp;
-#pragma omp critical(foliaupdate)
-  {
-    tmp = word->text( textclass );
-  }
+mwuAna *Mwu::make_ana( const SentenceRecord& rec, size_t i ) const {
+  UnicodeString tmp = rec.text[i];
   if ( filter )
     tmp = filter->filter( tmp );
   string txt = UnicodeToUTF8( tmp );
-  mWords.push_back( new mwuAna( word, txt, glue_tag ) );
+  return new mwuAna( rec.words[i], txt, rec.tags[i] == glue_tag );
 }
 
 
@@ -212,9 +186,9 @@ bool Mwu::init( const Configuration& config ) {
   return true;
 }
 
-ostream &operator<<( ostream& os, const Mwu& mwu ){
-  for ( size_t i = 0; i < mwu.mWords.size(); ++i )
-    os << i+1 << "\t" << mwu.mWords[i]->getWord() << endl;
+static ostream &operator<<( ostream& os, const vector<mwuAna*>& mWords ){
+  for ( size_t i = 0; i < mWords.size(); ++i )
+    os << i+1 << "\t" << mWords[i]->getWord() << endl;
   return os;
 }
 
@@ -228,36 +202,23 @@ void Mwu::addDeclaration( Document& doc ) const {
   }
 }
 
-void Mwu::Classify( const vector<Word*>& words ){
-  if ( words.empty() ){
+void Mwu::Classify( SentenceRecord& rec,
+		    AnnotationBuffer& buf ) const {
+  if ( rec.empty() ){
     return;
   }
-  reset();
-  for ( const auto& word : words ){
-    add( word );
-  }
-  Classify();
-  EntitiesLayer *el = 0;
-  Sentence *sent;
-#pragma omp critical(foliaupdate)
-  {
-    sent = words[0]->sentence();
-  }
-  for ( const auto& mword : mWords ){
-    el = mword->addEntity( mwu_tagset, sent, el );
-  }
-}
-
-void Mwu::Classify(){
-  if ( debug ) {
-    LOG << "Starting mwu Classify" << endl;
+  // all state is local, so a Mwu can serve several threads at once
+  vector<mwuAna*> mWords;
+  mWords.reserve( rec.size() );
+  for ( size_t i=0; i < rec.size(); ++i ){
+    mWords.push_back( make_ana( rec, i ) );
   }
-  mymap2::iterator best_match;
-  size_t matchLength = 0;
+  // add all current sequences of the glue_tag words as extra MWUs.
+  // these are only valid for this sentence, so sentences don't influence
+  // each other and may be handled in any order.
+  mymap2 glued;
   size_t max = mWords.size();
-
-  // add all current sequences of the glue_tag words to MWUs
-  for ( size_t i=0; i < max-1; ++i ) {
+  for ( size_t i=0; i+1 < max; ++i ) {
     if ( mWords[i]->isSpec() && mWords[i+1]->isSpec() ) {
       vector<string> newmwu;
       while ( i < max && mWords[i]->isSpec() ){
@@ -266,26 +227,57 @@ void Mwu::Classify(){
       }
       string key = newmwu[0];
       newmwu.erase( newmwu.begin() );
-      MWUs.insert( make_pair(key, newmwu) );
+      glued.insert( make_pair(key, newmwu) );
+    }
+  }
+  Classify( mWords, glued );
+  rec.mwus.clear();
+  vector<vector<Word*>> mwus;
+  size_t pos = 0;
+  for ( const auto& mword : mWords ){
+    size_t len = mword->getFWords().size();
+    if ( len > 1 ){
+      rec.mwus.push_back( make_pair( pos, len ) );
+      mwus.push_back( mword->getFWords() );
     }
+    pos += len;
+    delete mword;
   }
+  if ( !mwus.empty() ){
+    Sentence *sent = rec.words[0]->sentence();
+    const string& ts = mwu_tagset;
+    buf.add( [ts,sent,mwus](){ addEntities( ts, sent, mwus ); } );
+  }
+}
+
+void Mwu::Classify( vector<mwuAna*>& mWords, const mymap2& glued ) const {
+  if ( debug ) {
+    LOG << "Starting mwu Classify" << endl;
+  }
+  mymap2::const_iterator best_match;
+  size_t matchLength = 0;
+  size_t max = mWords.size();
+  const mymap2 *dictionaries[] = { &MWUs, &glued };
   size_t i;
   for ( i = 0; i < max; i++) {
     string word = mWords[i]->getWord();
     if ( debug ){
       LOG << "checking word[" << i <<"]: " << word << endl;
     }
-    //    pair<mymap2::iterator, mymap2::iterator> matches = MWUs.equal_range(word);
-    const auto matches = MWUs.equal_range(word);
-    if ( matches.first != MWUs.end() ) {
+    bool found = false;
+    for ( const auto& dict : dictionaries ){
+      const auto matches = dict->equal_range(word);
+      if ( matches.first == matches.second ) {
+	continue;
+      }
       //match
+      found = true;
       auto current_match = matches.first;
       if (  debug  ) {
 	LOG << "MWU: match found!\t" << current_match->first << endl;
       }
-      while( current_match != matches.second
-	     && current_match != MWUs.end() ){
-	vector<string> match = current_match->second;
+      while( current_match != matches.second ){
+	const vector<string>& match = current_match->second;
 	size_t max_match = match.size();
 	size_t j = 0;
 	if ( debug ){
@@ -314,6 +306,8 @@ void Mwu::Classify(){
 	}
 	++current_match;
       } // while
+    }
+    if ( found ){
       if( debug ){
 	if (matchLength >0 ) {
 	  LOG << "MWU: found match starting with " << (*best_match).first << endl;
@@ -349,9 +343,9 @@ void Mwu::Classify(){
     mWords.erase(anatmp1, anatmp2);
     if ( debug ){
       LOG << "tussenstand:" << endl;
-      LOG << *this << endl;
+      LOG << mWords << endl;
     }
-    Classify( );
+    Classify( mWords, glued );
   } //if (matchLength)
   return;
 } // //Classify
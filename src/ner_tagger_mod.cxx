@@ -292,18 +292,16 @@ static void addEntity( folia::Sentence *sent,
 		       const vector<folia::Word*>& words,
 		       const vector<double>& confs,
 		       const string& NER ){
+  // called from an AnnotationBuffer commit
   folia::EntitiesLayer *el = 0;
-#pragma omp critical(foliaupdate)
-  {
-    try {
-      el = sent->annotation<folia::EntitiesLayer>();
-    }
-    catch(...){
-      folia::KWargs args;
-      args["generate_id"] = sent->id();
-      el = new folia::EntitiesLayer( args, sent->doc() );
-      sent->append( el );
-    }
+  try {
+    el = sent->annotation<folia::EntitiesLayer>();
+  }
+  catch(...){
+    folia::KWargs args;
+    args["generate_id"] = sent->id();
+    el = new folia::EntitiesLayer( args, sent->doc() );
+    sent->append( el );
   }
   double c = 0;
   for ( auto const& val : confs ){
@@ -315,29 +313,35 @@ static void addEntity( folia::Sentence *sent,
   args["confidence"] =  toString(c);
   args["set"] = tagset;
   args["generate_id"] = el->id();
-  folia::Entity *e = 0;
-#pragma omp critical(foliaupdate)
-  {
-    e = new folia::Entity( args, el->doc() );
-    el->append( e );
-  }
+  folia::Entity *e = new folia::Entity( args, el->doc() );
+  el->append( e );
   for ( const auto& word : words ){
-#pragma omp critical(foliaupdate)
-    {
-      e->append( word );
-    }
+    e->append( word );
   }
 }
 
-void NERTagger::addNERTags( const vector<folia::Word*>& words,
+static void record_entity( SentenceRecord& rec,
+			   const vector<size_t>& positions,
+			   const string& NER ){
+  // the B- and I- tags of the words of an entity
+  for ( size_t j=0; j < positions.size(); ++j ){
+    rec.entities[positions[j]] = ( j == 0 ? "B-" : "I-" ) + NER;
+  }
+}
+
+void NERTagger::addNERTags( SentenceRecord& rec,
 			    const vector<string>& tags,
-			    const vector<double>& confs ){
+			    const vector<double>& confs,
+			    AnnotationBuffer& buf ){
+  const vector<folia::Word*>& words = rec.words;
   if ( words.empty() ) {
     return;
   }
   folia::Sentence *sent = words[0]->sentence();
+  const string& ts = tagset;
   vector<folia::Word*> stack;
   vector<double> dstack;
+  vector<size_t> positions;
   string curNER;
   for ( size_t i=0; i < tags.size(); ++i ){
     if (debug){
@@ -352,9 +356,12 @@ void NERTagger::addNERTags( const vector<folia::Word*>& words,
 	  LOG << "ners  " << stack << endl;
 	  LOG << "confs " << dstack << endl;
 	}
-	addEntity( sent, tagset, stack, dstack, curNER );
+	buf.add( [sent,ts,stack,dstack,curNER](){
+	    addEntity( sent, ts, stack, dstack, curNER ); } );
+	record_entity( rec, positions, curNER );
 	dstack.clear();
 	stack.clear();
+	positions.clear();
       }
       continue;
     }
@@ -377,14 +384,18 @@ void NERTagger::addNERTags( const vector<folia::Word*>& words,
 	  using TiCC::operator<<;
 	  LOG << "spit out " << stack << endl;
 	}
-	addEntity( sent, tagset, stack, dstack, curNER );
+	buf.add( [sent,ts,stack,dstack,curNER](){
+	    addEntity( sent, ts, stack, dstack, curNER ); } );
+	record_entity( rec, positions, curNER );
 	dstack.clear();
 	stack.clear();
+	positions.clear();
       }
       curNER = ner[1];
     }
     dstack.push_back( confs[i] );
     stack.push_back( words[i] );
+    positions.push_back( i );
   }
   if ( !stack.empty() ){
     if ( debug ){
@@ -392,7 +403,9 @@ void NERTagger::addNERTags( const vector<folia::Word*>& words,
       using TiCC::operator<<;
       LOG << "spit out " << stack << endl;
     }
-    addEntity( sent, tagset, stack, dstack, curNER );
+    buf.add( [sent,ts,stack,dstack,curNER](){
+	addEntity( sent, ts, stack, dstack, curNER ); } );
+    record_entity( rec, positions, curNER );
   }
 }
 
@@ -406,21 +419,19 @@ void NERTagger::addDeclaration( folia::Document& doc ) const {
   }
 }
 
-void NERTagger::Classify( const vector<folia::Word *>& swords ){
+void NERTagger::Classify( SentenceRecord& rec,
+			  AnnotationBuffer& buf ){
+  const vector<folia::Word *>& swords = rec.words;
   if ( !swords.empty() ) {
     vector<string> words;
     string sentence; // the tagger needs the whole sentence
-    for ( const auto& sw : swords ){
-      UnicodeString word;
-#pragma omp critical(foliaupdate)
-      {
-	word = sw->text( textclass );
-      }
+    for ( size_t i=0; i < rec.size(); ++i ){
+      UnicodeString word = rec.text[i];
       if ( filter )
 	word = filter->filter( word );
       sentence += folia::UnicodeToUTF8(word);
       words.push_back( folia::UnicodeToUTF8(word) );
-      if ( &sw != &swords.back() ){
+      if ( i < rec.size()-1 ){
 	sentence += " ";
       }
     }
@@ -458,7 +469,7 @@ void NERTagger::Classify( const vector<folia::Word *>& swords ){
     vector<string> ktags( tagv.size(), "O" );
     handle_known_ners( words, ktags );
     merge( ktags, tags, conf );
-    addNERTags( swords, tags, conf );
+    addNERTags( rec, tags, conf, buf );
   }
 }
 
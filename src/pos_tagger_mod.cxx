@@ -190,12 +190,14 @@ bool POSTagger::init( const Configuration& config ){
   return tagger->isInit();
 }
 
-void POSTagger::addTag( folia::Word *word,
+void POSTagger::addTag( SentenceRecord& rec,
+			size_t i,
 			const string& inputTag,
 			double confidence,
-			bool /*known NOT USED yet*/ ){
+			bool /*known NOT USED yet*/,
+			AnnotationBuffer& buf ){
   string pos_tag = inputTag;
-  string ucto_class = word->cls();
+  const string& ucto_class = rec.token_class[i];
   if ( debug ){
     LOG << "lookup ucto class= " << ucto_class << endl;
   }
@@ -208,14 +210,15 @@ void POSTagger::addTag( folia::Word *word,
     pos_tag = tt->second;
     confidence = 1.0;
   }
+  rec.tags[i] = pos_tag;
   folia::KWargs args;
   args["set"]  = tagset;
   args["class"]  = pos_tag;
   args["confidence"]= toString(confidence);
-#pragma omp critical(foliaupdate)
-  {
-    word->addPosAnnotation( args );
-  }
+  // the confidence as FoLiA will hold it, so all output formats agree
+  rec.confidences[i] = stringTo<double>( args["confidence"] );
+  folia::Word *word = rec.words[i];
+  buf.add( [word,args](){ word->addPosAnnotation( args ); } );
   //  folia::FoliaElement *pos = 0;
   //#pragma omp critical(foliaupdate)
   //  {
@@ -254,15 +257,13 @@ string POSTagger::set_eos_mark( const std::string& eos ){
     throw runtime_error( "POSTagger is not initialized" );
 }
 
-void POSTagger::Classify( const vector<folia::Word*>& swords ){
+void POSTagger::Classify( SentenceRecord& rec,
+			  AnnotationBuffer& buf ){
+  const vector<folia::Word*>& swords = rec.words;
   if ( !swords.empty() ) {
     string sentence; // the tagger needs the whole sentence
     for ( size_t w = 0; w < swords.size(); ++w ) {
-      UnicodeString word;
-#pragma omp critical(foliaupdate)
-      {
-	word = swords[w]->text( textclass );
-      }
+      UnicodeString word = rec.text[w];
       if ( filter )
 	word = filter->filter( word );
       sentence += folia::UnicodeToUTF8(word);
@@ -294,10 +295,12 @@ void POSTagger::Classify( const vector<folia::Word*>& swords ){
       }
     }
     for ( size_t i=0; i < tagv.size(); ++i ){
-      addTag( swords[i],
+      addTag( rec,
+	      i,
 	      tagv[i].assignedTag(),
 	      tagv[i].confidence(),
-	      tagv[i].isKnown() );
+	      tagv[i].isKnown(),
+	      buf );
     }
   }
 }
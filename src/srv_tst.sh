@@ -0,0 +1,46 @@
+#! /bin/bash
+
+# a batching, streaming server must still answer after a reload (SIGHUP)
+port=${FROG_TEST_PORT:-12345}
+./frog --skip=p -S $port --batch-window=20 --streaming 2> srv.log &
+pid=$!
+trap 'kill -9 $pid 2> /dev/null' EXIT
+
+# wait for the server to listen
+for i in $(seq 1 300); do
+  if exec 3<> /dev/tcp/localhost/$port; then
+    break
+  fi 2> /dev/null
+  if ! kill -0 $pid 2> /dev/null; then
+    echo "the server didn't start"
+    exit 1
+  fi
+  sleep 1
+done
+
+kill -HUP $pid
+for i in $(seq 1 300); do
+  if grep -q "new models in use" srv.log; then
+    break
+  fi
+  sleep 1
+done
+if ! grep -q "new models in use" srv.log; then
+  echo "the reload didn't finish"
+  exit 1
+fi
+
+{ cat $srcdir/../tests/tst.txt; echo EOT; } >&3
+: > srv.out
+line=""
+while read -t 120 -r line <&3; do
+  if [ "$line" = "READY" ]; then
+    break
+  fi
+  echo "$line" >> srv.out
+done
+if [ "$line" != "READY" ] || ! kill -0 $pid 2> /dev/null; then
+  echo "no reply after the reload"
+  exit 1
+fi
+diff -w srv.out $srcdir/../tests/tst.ok